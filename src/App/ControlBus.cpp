@@ -22,8 +22,10 @@ ControlBus::ControlBus()
     }
     GND = tiedowns[0]->Y;
     GND->state = PinState::Low;
+    GND->feed = Circuit::the().GND;
     VCC = tiedowns[1]->Y;
     VCC->state = PinState::High;
+    VCC->feed = Circuit::the().VCC;
     CLK = tiedowns[2]->Y;
     CLK->feed = clock_switch->Y;
     CLK_ = tiedowns[3]->Y;
@@ -90,30 +92,45 @@ void ControlBus::set_addr(uint8_t op)
     set_pins(ADDR, op);
 }
 
-void ControlBus::data_transfer(uint8_t from, uint8_t to, uint8_t op) const
+void ControlBus::transfer(uint8_t from, uint8_t to, uint8_t op)
 {
-    XDATA_->new_state = PinState::Low;
-    XADDR_->new_state = PinState::High;
     if (from != 0xFF) {
-        set_pins(GET, from & 0x0F);
+        set_get(from);
     }
     if (to != 0xFF) {
-        set_pins(PUT, to & 0x0F);
+        set_put(to);
+    }
+    set_op(op);
+}
+
+// Applies a data transfer between two registers directly if both have a
+// registered endpoint. Returns false if either side is only available at gate
+// level, in which case the caller drives the bus pins as usual.
+bool ControlBus::transact(uint8_t from, uint8_t to)
+{
+    if (!transactions || from >= endpoints.size() || to >= endpoints.size() || !endpoints[from].get || !endpoints[to].put) {
+        ++transactions_deferred;
+        return false;
     }
-    set_pins(OP, op & 0x0F);
+    auto value = endpoints[from].get();
+    endpoints[to].put(value);
+    set_data(value);
+    ++transactions_applied;
+    return true;
+}
+
+void ControlBus::data_transfer(uint8_t from, uint8_t to, uint8_t op)
+{
+    XDATA_->new_state = PinState::Low;
+    XADDR_->new_state = PinState::High;
+    transfer(from, to, op);
 }
 
-void ControlBus::addr_transfer(uint8_t from, uint8_t to, uint8_t op) const
+void ControlBus::addr_transfer(uint8_t from, uint8_t to, uint8_t op)
 {
     XDATA_->new_state = PinState::High;
     XADDR_->new_state = PinState::Low;
-    if (from != 0xFF) {
-        set_pins(GET, from & 0x0F);
-    }
-    if (to != 0xFF) {
-        set_pins(PUT, to & 0x0F);
-    }
-    set_pins(OP, op & 0x0F);
+    transfer(from, to, op);
 }
 
 void ControlBus::enable_oscillator()
@@ -126,6 +143,20 @@ void ControlBus::disable_oscillator()
     CLK->feed = clock_switch->Y;
 }
 
+void ControlBus::save(Checkpoint &checkpoint) const
+{
+    checkpoint.write<uint8_t>(CLK->feed == oscillator->Y);
+}
+
+void ControlBus::restore(Checkpoint &checkpoint)
+{
+    if (checkpoint.read<uint8_t>()) {
+        enable_oscillator();
+    } else {
+        disable_oscillator();
+    }
+}
+
 void bus_label(Board &board, int op, std::string const &label)
 {
     board.add_text(1, 21 + 2 * op, label);
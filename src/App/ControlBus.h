@@ -14,28 +14,40 @@
 
 namespace Simul {
 
+// Behavioural access to a register on a card, used to apply a bus transfer
+// as a single transaction instead of letting the decoders and latches of the
+// cards settle over many ticks.
+struct BusEndpoint {
+    std::function<uint8_t()>     get {};
+    std::function<void(uint8_t)> put {};
+};
+
 struct ControlBus : public Device {
-    Pin                      *GND;
-    Pin                      *VCC;
-    Pin                      *CLK;
-    Pin                      *CLK_;
-    Pin                      *CLKburst;
-    Pin                      *HLT_;
-    Pin                      *SUS_;
-    Pin                      *XDATA_;
-    Pin                      *XADDR_;
-    Pin                      *SACK_;
-    Pin                      *IO_;
-    Pin                      *RST;
-    Switch<200>              *clock_switch;
-    Oscillator               *oscillator;
-    std::array<Pin *, 4>      OP {};
-    std::array<Pin *, 4>      PUT {};
-    std::array<Pin *, 4>      GET {};
-    std::array<Pin *, 24>     controls {};
-    std::array<Pin *, 8>      D {};
-    std::array<Pin *, 8>      ADDR {};
-    std::array<TieDown *, 40> tiedowns {};
+    Pin                        *GND;
+    Pin                        *VCC;
+    Pin                        *CLK;
+    Pin                        *CLK_;
+    Pin                        *CLKburst;
+    Pin                        *HLT_;
+    Pin                        *SUS_;
+    Pin                        *XDATA_;
+    Pin                        *XADDR_;
+    Pin                        *SACK_;
+    Pin                        *IO_;
+    Pin                        *RST;
+    Switch<200>                *clock_switch;
+    Oscillator                 *oscillator;
+    std::array<Pin *, 4>        OP {};
+    std::array<Pin *, 4>        PUT {};
+    std::array<Pin *, 4>        GET {};
+    std::array<Pin *, 24>       controls {};
+    std::array<Pin *, 8>        D {};
+    std::array<Pin *, 8>        ADDR {};
+    std::array<TieDown *, 40>   tiedowns {};
+    std::array<BusEndpoint, 16> endpoints {};
+    bool                        transactions { false };
+    size_t                      transactions_applied { 0 };
+    size_t                      transactions_deferred { 0 };
 
     ControlBus();
     void set_op(uint8_t op);
@@ -43,10 +55,14 @@ struct ControlBus : public Device {
     void set_get(uint8_t op);
     void set_data(uint8_t op);
     void set_addr(uint8_t op);
-    void data_transfer(uint8_t from, uint8_t to, uint8_t op = 0) const;
-    void addr_transfer(uint8_t from, uint8_t to, uint8_t op = 0) const;
+    void data_transfer(uint8_t from, uint8_t to, uint8_t op = 0);
+    void addr_transfer(uint8_t from, uint8_t to, uint8_t op = 0);
+    void transfer(uint8_t from, uint8_t to, uint8_t op);
+    bool transact(uint8_t from, uint8_t to);
     void enable_oscillator();
     void disable_oscillator();
+    void save(Checkpoint &checkpoint) const override;
+    void restore(Checkpoint &checkpoint) override;
 };
 
 void bus_label(Board &board, int op, std::string const &label);
@@ -83,6 +83,11 @@ GP_Register::GP_Register(System &system, int reg_no)
 
     U8->A[0]->feed = U1->Y[reg_no];
     U8->B[0]->feed = bus->XDATA_;
+
+    bus->endpoints[reg_no] = {
+        [this]() -> uint8_t { return get_pins(U4->Q); },
+        [this](uint8_t value) -> void { U4->load(value); },
+    };
 }
 
 Card make_GP_Register(System &system, int reg_no)
@@ -6,16 +6,13 @@
 
 #include "MicroCode.h"
 #include <Lib/FileBuffer.h>
-#include <Lib/Grammar/Parser.h>
-#include <Lib/GrammarParser/GrammarParser.h>
+#include <Lib/Grammar/TableParser.h>
 #include <Lib/Unescape.h>
 
 namespace Simul {
 
 using namespace Lib;
 
-#include "microcode.grammar"
-
 struct MCParser {
     bool                       log { false };
     std::vector<MicroCodeStep> steps {};
@@ -29,46 +26,14 @@ struct MCParser {
     }
 };
 
-Result<std::vector<MicroCodeStep>, std::string> parse_microcode(std::string const &file_name)
-{
-    GrammarParser gp { microcode_grammar };
-    Grammar       grammar {};
-    if (auto e = gp.parse(grammar); e.is_error()) {
-        return std::format("{} Error parsing grammar", gp.lexer.location);
-    }
-    bool             log { false };
-    Parser<MCParser> p { grammar };
-    p.log = log;
-
-    std::vector<FileBuffer> buffers;
-    auto                    parse_file = [&buffers, &p, log](std::string_view const &file_name) -> Error<std::string> {
-        auto unescapify = [](char *buffer, size_t size) -> size_t {
-            return unescape(buffer, size);
-        };
-        if (auto fb = FileBuffer::from_file_filter(file_name, unescapify); fb.is_error()) {
-            return std::format("Error opening {}: {} ={}=", file_name, fb.error().to_string(), fs::current_path().string());
-        } else {
-            buffers.emplace_back(std::move(fb.value()));
-            p.parse(buffers.back().contents(), file_name).must();
-            return {};
-        }
-    };
-    if (auto e = parse_file(file_name); e.is_error()) {
-        return e.error();
-    }
-    return std::move(p.impl.steps);
-}
-
 }
 
 using namespace Simul;
 using namespace Lib;
 
-using P = Parser<MCParser>;
-
-extern "C" {
+using P = TableParser<MCParser>;
 
-[[maybe_unused]] void set_action(P *parser)
+static void set_action(P *parser)
 {
     auto &step = parser->impl.steps.emplace_back();
     if (parser->last_token.text == "D") {
@@ -88,7 +53,7 @@ extern "C" {
     }
 }
 
-[[maybe_unused]] void set_get_reg(P *parser)
+static void set_get_reg(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -106,7 +71,7 @@ extern "C" {
     }
 }
 
-[[maybe_unused]] void set_put_reg(P *parser)
+static void set_put_reg(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -124,7 +89,7 @@ extern "C" {
     }
 }
 
-[[maybe_unused]] void set_op_bits(P *parser)
+static void set_op_bits(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -138,7 +103,7 @@ extern "C" {
     }
 }
 
-[[maybe_unused]] void set_address(P *parser)
+static void set_address(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -152,7 +117,7 @@ extern "C" {
     }
 }
 
-[[maybe_unused]] void append_value(P *parser)
+static void append_value(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -165,7 +130,8 @@ extern "C" {
         UNREACHABLE();
     }
 }
-[[maybe_unused]] void set_d_value(P *parser)
+
+static void set_d_value(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -179,7 +145,7 @@ extern "C" {
     }
 }
 
-[[maybe_unused]] void set_a_value(P *parser)
+static void set_a_value(P *parser)
 {
     auto &step = parser->impl.steps.back();
     if (parser->last_token.kind.tag() == KindTag::Number) {
@@ -192,4 +158,40 @@ extern "C" {
         UNREACHABLE();
     }
 }
+
+// Generated from microcode.grammar by grammar2cpp at build time.
+#include <App/microcode_parser.h>
+
+namespace Simul {
+
+Result<std::vector<MicroCodeStep>, std::string> parse_microcode(std::string const &file_name)
+{
+    bool log { false };
+    P    p { microcode_tables };
+    p.log = log;
+
+    std::vector<FileBuffer> buffers;
+    auto                    parse_file = [&buffers, &p, log](std::string_view const &file_name) -> Error<std::string> {
+        auto unescapify = [](char *buffer, size_t size) -> size_t {
+            return unescape(buffer, size);
+        };
+        if (auto fb = FileBuffer::from_file_filter(file_name, unescapify); fb.is_error()) {
+            return std::format("Error opening {}: {} ={}=", file_name, fb.error().to_string(), fs::current_path().string());
+        } else {
+            buffers.emplace_back(std::move(fb.value()));
+            p.parse(buffers.back().contents(), file_name).must();
+            return {};
+        }
+    };
+    if (auto e = parse_file(file_name); e.is_error()) {
+        return e.error();
+    }
+    return std::move(p.impl.steps);
+}
+
+uint64_t microcode_grammar_hash()
+{
+    return microcode_tables.grammar_hash;
+}
+
 }
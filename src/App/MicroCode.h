@@ -100,5 +100,6 @@ struct MicroCodeStep {
 };
 
 Result<std::vector<MicroCodeStep>, std::string> parse_microcode(std::string const &file_name);
+uint64_t                                        microcode_grammar_hash();
 
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+#include "MicroCodeImage.h"
+#include <Lib/Hash.h>
+
+namespace Simul {
+
+namespace fs = std::filesystem;
+
+MicroCodeImage MicroCodeImage::compile(std::vector<MicroCodeStep> const &steps, uint64_t source_hash)
+{
+    MicroCodeImage ret { source_hash, microcode_compiler_hash() };
+    ret.words.reserve(steps.size());
+    for (auto const &step : steps) {
+        switch (step.action) {
+        case MicroCodeAction::XData:
+        case MicroCodeAction::XAddr: {
+            auto const &tx = std::get<Transfer>(step.payload);
+            ret.words.push_back(encode(step.action, tx.get_from, tx.put_to, tx.op_bits));
+        } break;
+        case MicroCodeAction::SetMem: {
+            auto const &block = std::get<MemBlock>(step.payload);
+            ret.memory.push_back({ static_cast<uint16_t>(block.address), block.bytes });
+            ret.words.push_back(encode(step.action));
+        } break;
+        case MicroCodeAction::Monitor: {
+            auto const &mon = std::get<MonitorValue>(step.payload);
+            ret.words.push_back(encode(step.action));
+            ret.words.push_back(static_cast<uint16_t>(mon.d | (mon.a << 8)));
+        } break;
+        }
+    }
+    return ret;
+}
+
+// The serialized image is the header (magic, version, source and compiler
+// hash), the control words, and the memory blocks, all little-endian.
+std::vector<uint8_t> MicroCodeImage::serialize() const
+{
+    std::vector<uint8_t> ret {};
+    auto                 write = [&ret]<typename T>(T value) {
+        auto at = ret.size();
+        ret.resize(at + sizeof(T));
+        memcpy(ret.data() + at, &value, sizeof(T));
+    };
+    write(Magic);
+    write(Version);
+    write(source_hash);
+    write(compiler_hash);
+    write(static_cast<uint32_t>(words.size()));
+    for (auto word : words) {
+        write(word);
+    }
+    write(static_cast<uint32_t>(memory.size()));
+    for (auto const &block : memory) {
+        write(block.address);
+        write(static_cast<uint32_t>(block.bytes.size()));
+        ret.insert(ret.end(), block.bytes.begin(), block.bytes.end());
+    }
+    return ret;
+}
+
+std::optional<MicroCodeImage> MicroCodeImage::deserialize(std::span<uint8_t const> data)
+{
+    size_t pos { 0 };
+    auto   read = [&data, &pos]<typename T>(T &value) -> bool {
+        if (pos + sizeof(T) > data.size()) {
+            return false;
+        }
+        memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    };
+    uint32_t       magic { 0 };
+    uint32_t       version { 0 };
+    uint32_t       count { 0 };
+    MicroCodeImage ret {};
+    if (!read(magic) || magic != Magic || !read(version) || version != Version || !read(ret.source_hash) || !read(ret.compiler_hash) || !read(count)) {
+        return {};
+    }
+    if (count > (data.size() - pos) / sizeof(uint16_t)) {
+        return {};
+    }
+    ret.words.resize(count);
+    for (auto &word : ret.words) {
+        read(word);
+    }
+    if (!read(count)) {
+        return {};
+    }
+    for (auto ix = 0; ix < count; ++ix) {
+        auto    &block = ret.memory.emplace_back();
+        uint32_t size { 0 };
+        if (!read(block.address) || !read(size) || size > data.size() - pos) {
+            return {};
+        }
+        block.bytes.assign(data.begin() + pos, data.begin() + pos + size);
+        pos += size;
+    }
+    return ret;
+}
+
+uint64_t microcode_compiler_hash()
+{
+    return Lib::fnv1a(std::format("{:016x}:{}", microcode_grammar_hash(), MicroCodeImage::Version));
+}
+
+static std::optional<std::vector<uint8_t>> read_file(fs::path const &path)
+{
+    std::ifstream in { path, std::ios::binary };
+    if (!in) {
+        return {};
+    }
+    return std::vector<uint8_t> { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+}
+
+Result<MicroCodeImage, std::string> load_microcode(std::string const &file_name, bool use_cache)
+{
+    auto source = read_file(file_name);
+    if (!source) {
+        return std::format("Error opening {}", file_name);
+    }
+    auto hash = Lib::fnv1a({ reinterpret_cast<char const *>(source->data()), source->size() });
+    auto cache_name = fs::path { file_name }.replace_extension(".mcb");
+    if (use_cache) {
+        if (auto cached = read_file(cache_name); cached) {
+            if (auto image = MicroCodeImage::deserialize(*cached); image && image->source_hash == hash && image->compiler_hash == microcode_compiler_hash()) {
+                return std::move(*image);
+            }
+        }
+    }
+
+    auto steps = parse_microcode(file_name);
+    if (steps.is_error()) {
+        return steps.error();
+    }
+    auto image = MicroCodeImage::compile(steps.value(), hash);
+    if (use_cache) {
+        // A cache that can not be written only costs the next run a parse.
+        auto          bytes = image.serialize();
+        std::ofstream out { cache_name, std::ios::binary };
+        out.write(reinterpret_cast<char const *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+    return image;
+}
+
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <App/MicroCode.h>
+
+namespace Simul {
+
+// A microcode program compiled to what the sequencer needs at run time: a
+// sequence of 16-bit control words and the memory contents to load before
+// the program starts.
+//
+// Control word layout:
+//   bits 0-3    register to get from
+//   bits 4-7    register to put to
+//   bits 8-11   ALU operation
+//   bits 12-13  MicroCodeAction
+// A Monitor word is followed by an operand word holding the data switches
+// in the low and the address switches in the high byte. A SetMem step keeps
+// its slot in the sequence as a word that does nothing, so that programs
+// take as many clock cycles as they did when they were run from the steps.
+struct MicroCodeImage {
+    static constexpr uint32_t Magic = 0x4D4D4953; // "SIMM"
+    static constexpr uint32_t Version = 2;
+
+    struct Block {
+        uint16_t             address { 0 };
+        std::vector<uint8_t> bytes {};
+    };
+
+    uint64_t              source_hash { 0 };
+    uint64_t              compiler_hash { 0 };
+    std::vector<uint16_t> words {};
+    std::vector<Block>    memory {};
+
+    static constexpr uint16_t encode(MicroCodeAction action, uint8_t get_from = 0, uint8_t put_to = 0, uint8_t op_bits = 0)
+    {
+        return static_cast<uint16_t>((get_from & 0x0F) | ((put_to & 0x0F) << 4) | ((op_bits & 0x0F) << 8) | (static_cast<int>(action) << 12));
+    }
+
+    static constexpr MicroCodeAction action(uint16_t word) { return static_cast<MicroCodeAction>((word >> 12) & 0x03); }
+    static constexpr uint8_t         get_from(uint16_t word) { return word & 0x0F; }
+    static constexpr uint8_t         put_to(uint16_t word) { return (word >> 4) & 0x0F; }
+    static constexpr uint8_t         op_bits(uint16_t word) { return (word >> 8) & 0x0F; }
+
+    [[nodiscard]] bool empty() const
+    {
+        return words.empty();
+    }
+
+    static MicroCodeImage                compile(std::vector<MicroCodeStep> const &steps, uint64_t source_hash = 0);
+    static std::optional<MicroCodeImage> deserialize(std::span<uint8_t const> data);
+    [[nodiscard]] std::vector<uint8_t>   serialize() const;
+};
+
+// Identifies the compiler an image was built by: the grammar of the
+// microcode parser and the version of the image format.
+uint64_t microcode_compiler_hash();
+
+// Loads a microcode program. The compiled image is cached next to the
+// source, with the extension replaced by .mcb, and is used instead of
+// parsing the source as long as both the hash of the source and the hash
+// of the compiler match.
+Result<MicroCodeImage, std::string> load_microcode(std::string const &file_name, bool use_cache = true);
+
+}
@@ -4,12 +4,18 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <charconv>
+#include <fstream>
+#include <print>
 #include <thread>
 #include <vector>
 
 #include <raylib.h>
 
+#include <Lib/Options.h>
+
 #include "Circuit/Graphics.h"
+#include "Circuit/Optimize.h"
 #include "MicroCode.h"
 #include "System.h"
 
@@ -17,19 +23,89 @@ namespace Simul {
 
 void main(int argc, char **argv)
 {
+    auto arg_ix = Lib::parse_options(argc, const_cast<char const **>(argv));
     InitWindow(30 * static_cast<int>(PITCH), 30 * static_cast<int>(PITCH), "Simul");
     SetWindowState(FLAG_VSYNC_HINT);
     {
         auto   font = LoadFontEx("fonts/Tecnico-Bold.ttf", 15, nullptr, 0);
         System system(font);
-        if (argc > 1) {
-            if (auto mc_maybe = parse_microcode(argv[1]); mc_maybe.is_error()) {
+        system.keep_all = Lib::has_option("keep-all");
+        system.lower_aig = Lib::has_option("aig");
+        system.shared_models = Lib::has_option("shared-models");
+        system.bus->transactions = Lib::has_option("transactions");
+        if (auto cone_inputs = Lib::get_option("cone-inputs"); cone_inputs) {
+            std::from_chars(cone_inputs->data(), cone_inputs->data() + cone_inputs->size(), system.cone_inputs);
+            if (system.cone_inputs > MaxConeInputs) {
+                std::println(std::cerr, "--cone-inputs must be at most {}", MaxConeInputs);
+                exit(1);
+            }
+        }
+        if (auto history = Lib::get_option("history"); history) {
+            size_t megabytes { 0 };
+            std::from_chars(history->data(), history->data() + history->size(), megabytes);
+            system.history_budget = megabytes * 1024 * 1024;
+        }
+        // ROM images are mapped read-only. RAM images are mapped copy-on-write,
+        // or shared with --persist-ram so that stores end up in the file.
+        if (auto rom = Lib::get_option("rom"); rom) {
+            if (auto err = system.rom->load_image(*rom, MemoryMapping::ReadOnly); err.is_error()) {
+                std::println(std::cerr, "Error loading ROM image {}: {}", *rom, err.error().to_string());
+                exit(1);
+            }
+        }
+        if (auto ram = Lib::get_option("ram"); ram) {
+            auto mapping = Lib::has_option("persist-ram") ? MemoryMapping::Shared : MemoryMapping::Private;
+            if (auto err = system.ram->load_image(*ram, mapping); err.is_error()) {
+                std::println(std::cerr, "Error loading RAM image {}: {}", *ram, err.error().to_string());
+                exit(1);
+            }
+        }
+        if (arg_ix < argc) {
+            if (auto mc_maybe = load_microcode(argv[arg_ix], !Lib::has_option("no-mc-cache")); mc_maybe.is_error()) {
                 std::cerr << mc_maybe.error() << "\n";
                 exit(1);
             } else {
                 std::swap(mc_maybe.value(), system.microcode);
             }
         }
+        if (Lib::has_option("profile") || Lib::has_option("profile-folded")) {
+            system.profiler = std::make_unique<Profiler>(system.circuit);
+        }
+        std::vector<std::string> probes {};
+        for (auto probe : Lib::get_option_values("probe")) {
+            probes.emplace_back(probe);
+        }
+        auto vcd = Lib::get_option("vcd");
+        auto trace = Lib::get_option("trace");
+        if (vcd && trace) {
+            std::println(std::cerr, "--vcd and --trace can not be combined");
+            exit(1);
+        }
+        if (vcd || trace) {
+            system.dump(std::string { vcd ? *vcd : *trace }, probes, !vcd);
+        }
+        if (auto activity = Lib::get_option("activity"); activity) {
+            system.track_activity = true;
+            if (*activity == "probes") {
+                system.activity_probes = probes;
+            }
+        }
+        // Watchpoints without a trace get the default trace size. A watchpoint
+        // pauses the simulation when it is hit; F8 continues.
+        auto watches = Lib::get_option_values("watch");
+        if (auto mem_trace = Lib::get_option("mem-trace"); mem_trace || !watches.empty()) {
+            size_t capacity { 64 * 1024 };
+            if (mem_trace && *mem_trace != "true") {
+                std::from_chars(mem_trace->data(), mem_trace->data() + mem_trace->size(), capacity);
+            }
+            system.memory_trace = std::make_unique<MemoryTrace>(system.circuit, capacity);
+            for (auto watch : watches) {
+                if (!system.memory_trace->watch(watch)) {
+                    std::println(std::cerr, "Invalid watchpoint '{}'", watch);
+                    exit(1);
+                }
+            }
+        }
         auto t = system.simulate();
         SetTargetFPS(60);
         {
@@ -42,6 +118,35 @@ void main(int argc, char **argv)
             }
             system.circuit.stop();
             t.join();
+            if (system.waveform) {
+                system.waveform->stop();
+            }
+            std::println(std::cerr, "{}", system.circuit.net_stats);
+            if (system.bus->transactions) {
+                std::println(std::cerr, "{} bus transactions applied, {} left to the pins",
+                    system.bus->transactions_applied, system.bus->transactions_deferred);
+            }
+            if (system.activity) {
+                size_t count { 20 };
+                if (auto top = Lib::get_option("activity-top"); top) {
+                    std::from_chars(top->data(), top->data() + top->size(), count);
+                }
+                system.activity->report(std::cerr, count);
+            }
+            if (system.memory_trace) {
+                size_t count { 32 };
+                if (auto tail = Lib::get_option("mem-trace-tail"); tail) {
+                    std::from_chars(tail->data(), tail->data() + tail->size(), count);
+                }
+                system.memory_trace->dump(std::cerr, count);
+            }
+            if (system.profiler) {
+                system.profiler->report(std::cerr);
+                if (auto folded = Lib::get_option("profile-folded"); folded) {
+                    std::ofstream out { std::string { *folded } };
+                    system.profiler->folded(out);
+                }
+            }
         }
         UnloadFont(font);
     }
@@ -4,10 +4,14 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <print>
+
 #include "System.h"
 #include "ALU.h"
 #include "Addr_Register.h"
 #include "Circuit/Graphics.h"
+#include "Circuit/Model.h"
+#include "Circuit/Optimize.h"
 #include "ControlBus.h"
 #include "GP_Register.h"
 #include "Mem_Register.h"
@@ -15,25 +19,36 @@
 
 namespace Simul {
 
-System::System(Font font)
+System::System(Font font, std::optional<ElaborationHandler> const &on_elaborated)
     : circuit(Circuit::the())
     , font(font)
 {
+    auto elaborated = [&on_elaborated](std::string_view part) {
+        if (on_elaborated) {
+            (*on_elaborated)(part);
+        }
+    };
+    auto add_card = [this, &elaborated](Card card) -> Card & {
+        auto &ret = cards.emplace_back(std::move(card));
+        elaborated(ret.circuit->name);
+        return ret;
+    };
     bus = make_backplane(*this);
-    cards.emplace_back(std::move(make_GP_Register(*this, 0)));
-    cards.emplace_back(std::move(make_GP_Register(*this, 1)));
-    cards.emplace_back(std::move(make_GP_Register(*this, 2)));
-    cards.emplace_back(std::move(make_GP_Register(*this, 3)));
-    cards.emplace_back(std::move(make_Addr_Register(*this, 8)));
-    cards.emplace_back(std::move(make_Addr_Register(*this, 9)));
-    cards.emplace_back(std::move(make_Addr_Register(*this, 10)));
-    cards.emplace_back(std::move(make_Addr_Register(*this, 11)));
-    cards.emplace_back(std::move(make_Addr_Register(*this, 12)));
-    auto &mem_card = cards.emplace_back(std::move(make_Mem_Register(*this)));
+    elaborated(bus->name);
+    add_card(make_GP_Register(*this, 0));
+    add_card(make_GP_Register(*this, 1));
+    add_card(make_GP_Register(*this, 2));
+    add_card(make_GP_Register(*this, 3));
+    add_card(make_Addr_Register(*this, 8));
+    add_card(make_Addr_Register(*this, 9));
+    add_card(make_Addr_Register(*this, 10));
+    add_card(make_Addr_Register(*this, 11));
+    add_card(make_Addr_Register(*this, 12));
+    auto &mem_card = add_card(make_Mem_Register(*this));
     rom = dynamic_cast<Mem_Register *>(mem_card.circuit)->U10;
     ram = dynamic_cast<Mem_Register *>(mem_card.circuit)->U9;
-    cards.emplace_back(std::move(make_ALU(*this)));
-    auto &mon_card = cards.emplace_back(std::move(make_Monitor(*this)));
+    add_card(make_ALU(*this));
+    auto &mon_card = add_card(make_Monitor(*this));
     monitor = dynamic_cast<Monitor *>(mon_card.circuit);
 
     for (auto ix = 0; ix < cards.size(); ++ix) {
@@ -49,6 +64,7 @@ System::System(Font font)
     }
 
     layout();
+    elaborated("Layout");
 
     bus->CLK->state = PinState::Low;
     bus->XDATA_->state = PinState::High;
@@ -94,8 +110,46 @@ void System::layout()
     }
 }
 
+Checkpoint System::checkpoint()
+{
+    std::unique_lock lock(circuit.yield_mutex);
+    auto             ret = save_checkpoint(circuit);
+    ret.write<uint64_t>(current_step);
+    return ret;
+}
+
+bool System::restore(Checkpoint &checkpoint)
+{
+    std::unique_lock lock(circuit.yield_mutex);
+    if (!restore_checkpoint(circuit, checkpoint)) {
+        return false;
+    }
+    current_step = checkpoint.read<uint64_t>();
+    return !checkpoint.failed;
+}
+
+bool System::seek(uint64_t tick)
+{
+    std::unique_lock lock(circuit.yield_mutex);
+    return history != nullptr && history->seek(tick);
+}
+
 void System::handle_input()
 {
+    if (IsKeyReleased(KEY_F5)) {
+        saved = checkpoint();
+    }
+    if (IsKeyReleased(KEY_F9) && saved) {
+        restore(*saved);
+    }
+    if (IsKeyReleased(KEY_F8)) {
+        circuit.paused = !circuit.paused;
+    }
+    // While paused, holding F6 runs the simulation backwards a tick per
+    // frame, as far back as the history reaches.
+    if (IsKeyDown(KEY_F6) && circuit.paused && history != nullptr && history->ticks > 0) {
+        seek(history->ticks - 1);
+    }
     if (IsMouseButtonReleased(MOUSE_BUTTON_RIGHT)) {
         current_step = 0;
         bus->enable_oscillator();
@@ -141,66 +195,163 @@ void System::render()
     }
 }
 
-std::thread System::simulate()
+// Dumps the bus groups, and every pin whose path starts with one of the
+// given probes, to a VCD file or a binary trace. Cards can be probed by their
+// name.
+void System::dump(std::string const &file_name, std::vector<std::string> const &probes, bool binary)
+{
+    if (binary) {
+        waveform = std::make_unique<TraceWriter>(circuit, file_name);
+    } else {
+        waveform = std::make_unique<VCDWriter>(circuit, file_name);
+    }
+    waveform->probe("BUS/CLK", std::span<Pin *const> { &bus->CLK, 1 });
+    waveform->probe("BUS/XDATA_", std::span<Pin *const> { &bus->XDATA_, 1 });
+    waveform->probe("BUS/XADDR_", std::span<Pin *const> { &bus->XADDR_, 1 });
+    waveform->probe("BUS/OP", bus->OP);
+    waveform->probe("BUS/PUT", bus->PUT);
+    waveform->probe("BUS/GET", bus->GET);
+    waveform->probe("BUS/D", bus->D);
+    waveform->probe("BUS/ADDR", bus->ADDR);
+    for (auto const &probe : probes) {
+        if (auto card = std::ranges::find_if(cards, [&probe](Card const &c) { return c.circuit->name == probe; }); card != cards.end()) {
+            waveform->probe(card->circuit);
+        } else {
+            waveform->probe(probe);
+        }
+    }
+}
+
+// Sets up the microcode, memory contents, optimizations and instrumentation
+// without starting the simulation thread.
+void System::prepare()
 {
     if (!microcode.empty()) {
         bus->enable_oscillator();
         bus->oscillator->on_low = [this](Oscillator *) {
-            if (microcode.empty() || current_step >= microcode.size()) {
+            auto const &words = microcode.words;
+            if (current_step >= words.size()) {
                 bus->disable_oscillator();
                 return;
             }
-            auto &step = microcode[current_step];
-            switch (step.action) {
+            auto word = words[current_step++];
+            switch (MicroCodeImage::action(word)) {
             case MicroCodeAction::XData:
                 bus->XDATA_->new_state = PinState::Low;
                 bus->XADDR_->new_state = PinState::High;
                 bus->IO_->new_state = PinState::High;
+                if (bus->transact(MicroCodeImage::get_from(word), MicroCodeImage::put_to(word))) {
+                    bus->XDATA_->new_state = PinState::High;
+                    break;
+                }
+                bus->set_get(MicroCodeImage::get_from(word));
+                bus->set_put(MicroCodeImage::put_to(word));
+                bus->set_op(MicroCodeImage::op_bits(word));
                 break;
             case MicroCodeAction::XAddr:
                 bus->XDATA_->new_state = PinState::High;
                 bus->XADDR_->new_state = PinState::Low;
                 bus->IO_->new_state = PinState::High;
+                bus->set_get(MicroCodeImage::get_from(word));
+                bus->set_put(MicroCodeImage::put_to(word));
+                bus->set_op(MicroCodeImage::op_bits(word));
                 break;
-            default:
-                break;
-            }
-            switch (step.payload.index()) {
-            case 0: {
-                auto &tx = std::get<Transfer>(step.payload);
-                bus->set_get(tx.get_from);
-                bus->set_put(tx.put_to);
-                bus->set_op(tx.op_bits);
-            } break;
-            case 2: {
-                auto &mon = std::get<MonitorValue>(step.payload);
-                set_pins(monitor->SW1, mon.d);
-                set_pins(monitor->SW2, mon.a);
+            case MicroCodeAction::Monitor: {
+                auto operand = (current_step < words.size()) ? words[current_step++] : 0;
+                set_pins(monitor->SW1, static_cast<uint8_t>(operand & 0xFF));
+                set_pins(monitor->SW2, static_cast<uint8_t>(operand >> 8));
             } break;
-            default:
+            case MicroCodeAction::SetMem:
                 break;
             }
-            current_step++;
-            if (current_step >= microcode.size()) {
+            if (current_step >= words.size()) {
                 bus->disable_oscillator();
             }
         };
 
-        for (auto &step : microcode) {
-            if (step.action == MicroCodeAction::SetMem) {
-                auto &block = std::get<MemBlock>(step.payload);
-                auto  addr = block.address;
-                for (auto bit : block.bytes) {
-                    if (addr & 0x8000) {
-                        rom->bytes[addr & 0x7FFF] = bit;
-                    } else {
-                        ram->bytes[addr] = bit;
+        for (auto const &block : microcode.memory) {
+            auto addr = block.address;
+            for (auto bit : block.bytes) {
+                if (addr & 0x8000) {
+                    if (rom->read_only()) {
+                        fatal("Microcode sets ROM address {:04x}, but the ROM image is mapped read-only", addr);
                     }
-                    ++addr;
+                    rom->bytes[addr & 0x7FFF] = bit;
+                    rom->pages.touch(addr & 0x7FFF);
+                } else {
+                    ram->bytes[addr] = bit;
+                    ram->pages.touch(addr);
                 }
+                ++addr;
+            }
+        }
+    }
+    // Pins picked with --activity=probes are tracked before the optimizations
+    // run, so that they are kept alive like waveform probes.
+    if (track_activity) {
+        activity = std::make_unique<Activity>(circuit);
+        for (auto const &probe : activity_probes) {
+            if (auto card = std::ranges::find_if(cards, [&probe](Card const &c) { return c.circuit->name == probe; }); card != cards.end()) {
+                activity->track(card->circuit);
+            } else {
+                activity->track(probe);
             }
         }
     }
+    if (!keep_all) {
+        auto observed = backplane->observed_pins();
+        for (auto &card : cards) {
+            for (auto const *board : { card.board.get(), card.edge.get() }) {
+                auto pins = board->observed_pins();
+                observed.insert(observed.end(), pins.begin(), pins.end());
+            }
+        }
+        auto reports = optimize(circuit);
+        reports.push_back(eliminate_dead_logic(circuit, observed));
+        for (auto const &report : reports) {
+            std::println(std::cerr, "{}", report);
+        }
+    }
+    if (cone_inputs > 0) {
+        std::println(std::cerr, "{}", compile_cones(circuit, cone_inputs));
+    }
+    if (lower_aig) {
+        std::println(std::cerr, "{}", *lower_to_aig(circuit));
+    }
+    if (shared_models) {
+        std::vector<Device *> card_circuits {};
+        for (auto &card : cards) {
+            card_circuits.push_back(card.circuit);
+        }
+        std::println(std::cerr, "{}", compile_models(circuit, card_circuits));
+    }
+    if (waveform) {
+        waveform->start();
+    }
+    if (history_budget > 0) {
+        history = std::make_unique<History>(circuit, history_budget);
+        history->track(ram);
+        history->track_value(current_step);
+        circuit.history = history.get();
+    }
+    if (memory_trace) {
+        memory_trace->attach(ram, "RAM", 0x0000);
+        memory_trace->attach(rom, "ROM", 0x8000);
+    }
+    if (profiler) {
+        profiler->attach();
+    }
+    if (track_activity) {
+        if (activity_probes.empty()) {
+            activity->track();
+        }
+        circuit.activity = activity.get();
+    }
+}
+
+std::thread System::simulate()
+{
+    prepare();
     auto t = circuit.start_simulation();
     return t;
 }
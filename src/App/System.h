@@ -6,11 +6,17 @@
 
 #pragma once
 
-#include <App/MicroCode.h>
+#include <App/MicroCodeImage.h>
 #include <App/Monitor.h>
+#include <Circuit/Activity.h>
+#include <Circuit/Checkpoint.h>
 #include <Circuit/Graphics.h>
+#include <Circuit/History.h>
 #include <Circuit/Memory.h>
+#include <Circuit/MemoryTrace.h>
 #include <Circuit/Oscillator.h>
+#include <Circuit/Profiler.h>
+#include <Circuit/Waveform.h>
 
 namespace Simul {
 
@@ -21,22 +27,42 @@ struct Card {
 };
 
 struct System {
-    Circuit                   &circuit;
-    struct ControlBus         *bus;
-    std::optional<int>         current_card {};
-    std::unique_ptr<Board>     backplane;
-    std::vector<Card>          cards;
-    Font                       font;
-    Vector2                    size {};
-    std::vector<MicroCodeStep> microcode {};
-    size_t                     current_step { 0 };
-    EEPROM_28C256             *rom;
-    SRAM_LY62256              *ram;
-    struct Monitor            *monitor;
-
-    explicit System(Font font);
+    using ElaborationHandler = std::function<void(std::string_view)>;
+
+    Circuit                        &circuit;
+    struct ControlBus              *bus;
+    std::optional<int>              current_card {};
+    std::unique_ptr<Board>          backplane;
+    std::vector<Card>               cards;
+    Font                            font;
+    Vector2                         size {};
+    MicroCodeImage                  microcode {};
+    size_t                          current_step { 0 };
+    bool                            keep_all { false };
+    bool                            lower_aig { false };
+    size_t                          cone_inputs { 0 };
+    bool                            shared_models { false };
+    std::optional<Checkpoint>       saved {};
+    size_t                          history_budget { 16 * 1024 * 1024 };
+    std::unique_ptr<History>        history {};
+    std::unique_ptr<WaveformWriter> waveform {};
+    std::unique_ptr<Profiler>       profiler {};
+    bool                            track_activity { false };
+    std::vector<std::string>        activity_probes {};
+    std::unique_ptr<Activity>       activity {};
+    std::unique_ptr<MemoryTrace>    memory_trace {};
+    EEPROM_28C256                  *rom;
+    SRAM_LY62256                   *ram;
+    struct Monitor                 *monitor;
+
+    explicit System(Font font, std::optional<ElaborationHandler> const &on_elaborated = {});
     std::unique_ptr<Board> make_board();
+    void                   dump(std::string const &file_name, std::vector<std::string> const &probes, bool binary);
+    void                   prepare();
     std::thread            simulate();
+    Checkpoint             checkpoint();
+    bool                   restore(Checkpoint &checkpoint);
+    bool                   seek(uint64_t tick);
     void                   layout();
     void                   handle_input();
     void                   render();
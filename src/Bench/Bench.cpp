@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <print>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Lib/Options.h>
+
+#include "App/ControlBus.h"
+#include "App/MicroCodeImage.h"
+#include "App/System.h"
+#include "Circuit/Circuit.h"
+#include "Circuit/UtilityDevice.h"
+#include "Elaboration.h"
+#include "Parse.h"
+#include "IC/LS193.h"
+#include "IC/LS377.h"
+#include "IC/LS382.h"
+
+namespace Simul {
+
+using namespace std::chrono_literals;
+
+// Every tick advances the simulated clock by a fixed step, so that runs are
+// reproducible and do not depend on the speed of the host.
+static constexpr duration Step = 1ms;
+
+struct Scenario {
+    std::string                   name;
+    std::function<void()>         setup;
+    std::function<bool(uint64_t)> stimulus;
+    std::function<void()>         teardown {};
+};
+
+struct Measurement {
+    std::string name;
+    uint64_t    ticks { 0 };
+    double      seconds { 0.0 };
+    double      evaluations_per_tick { 0.0 };
+
+    [[nodiscard]] double ticks_per_sec() const
+    {
+        return (seconds > 0.0) ? static_cast<double>(ticks) / seconds : 0.0;
+    }
+
+    [[nodiscard]] double ns_per_tick() const
+    {
+        return (ticks > 0) ? 1e9 * seconds / static_cast<double>(ticks) : 0.0;
+    }
+};
+
+static size_t evaluated_devices(Circuit &circuit)
+{
+    size_t ret = 0;
+    recurse_components(&circuit, [&ret](Device *dev) {
+        if (dev->live && dev->simulate_device) {
+            ++ret;
+        }
+    });
+    return ret;
+}
+
+static Measurement run(Scenario const &scenario, uint64_t max_ticks)
+{
+    auto &circuit = Circuit::the();
+    circuit.initialize(scenario.name);
+    scenario.setup();
+    circuit.prepare();
+    Measurement ret { scenario.name };
+    ret.evaluations_per_tick = static_cast<double>(evaluated_devices(circuit));
+    auto start = std::chrono::steady_clock::now();
+    for (; ret.ticks < max_ticks && scenario.stimulus(ret.ticks); ++ret.ticks) {
+        circuit.simulate(Step * static_cast<int64_t>(ret.ticks + 1));
+    }
+    ret.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (scenario.teardown) {
+        scenario.teardown();
+    }
+    return ret;
+}
+
+static std::array<TieDown *, 12> alu_inputs {};
+static std::array<TieDown *, 4>  counter_inputs {};
+static std::array<TieDown *, 9>  bank_inputs {};
+static std::mt19937              rng { 0x5eed };
+
+static void set_input(TieDown *input, bool value)
+{
+    input->Y->new_state = value ? PinState::High : PinState::Low;
+}
+
+// A single LS382 with all twelve inputs randomized every eight ticks.
+static Scenario ls382_random()
+{
+    return {
+        "ls382_random",
+        []() {
+            auto &circuit = Circuit::the();
+            auto *alu = circuit.add_component<LS382>();
+            for (auto &input : alu_inputs) {
+                input = circuit.add_component<TieDown>(PinState::Low);
+            }
+            for (auto ix = 0; ix < 4; ++ix) {
+                alu->A[ix]->feed = alu_inputs[ix]->Y;
+                alu->B[ix]->feed = alu_inputs[4 + ix]->Y;
+            }
+            for (auto ix = 0; ix < 3; ++ix) {
+                alu->S[ix]->feed = alu_inputs[8 + ix]->Y;
+            }
+            alu->Cin->feed = alu_inputs[11]->Y;
+        },
+        [](uint64_t tick) {
+            if (tick % 8 == 0) {
+                auto bits = rng();
+                for (auto ix = 0; ix < alu_inputs.size(); ++ix) {
+                    set_input(alu_inputs[ix], (bits >> ix) & 1);
+                }
+            }
+            return true;
+        },
+    };
+}
+
+// The four cascaded LS193 counters of an Addr_Register, counting up.
+static Scenario ls193_chain()
+{
+    return {
+        "ls193_chain",
+        []() {
+            auto &circuit = Circuit::the();
+            std::array<LS193 *, 4> counters {};
+            for (auto &counter : counters) {
+                counter = circuit.add_component<LS193>();
+            }
+            counter_inputs[0] = circuit.add_component<TieDown>(PinState::High); // Up
+            counter_inputs[1] = circuit.add_component<TieDown>(PinState::High); // Down
+            counter_inputs[2] = circuit.add_component<TieDown>(PinState::High); // Load_
+            counter_inputs[3] = circuit.add_component<TieDown>(PinState::Low);  // CLR
+            for (auto ix = 0; ix < counters.size(); ++ix) {
+                counters[ix]->Load_->feed = counter_inputs[2]->Y;
+                counters[ix]->CLR->feed = counter_inputs[3]->Y;
+                for (auto *d : counters[ix]->D) {
+                    d->feed = circuit.GND;
+                }
+                if (ix == 0) {
+                    counters[ix]->Up->feed = counter_inputs[0]->Y;
+                    counters[ix]->Down->feed = counter_inputs[1]->Y;
+                } else {
+                    counters[ix]->Up->feed = counters[ix - 1]->CO_;
+                    counters[ix]->Down->feed = counters[ix - 1]->BO_;
+                }
+            }
+        },
+        [](uint64_t tick) {
+            set_input(counter_inputs[0], (tick / 4) % 2 == 0);
+            return true;
+        },
+    };
+}
+
+// Eight LS377 registers on a shared clock and enable, loading random data.
+static Scenario ls377_bank()
+{
+    return {
+        "ls377_bank",
+        []() {
+            auto &circuit = Circuit::the();
+            for (auto ix = 0; ix < 8; ++ix) {
+                bank_inputs[ix] = circuit.add_component<TieDown>(PinState::Low);
+            }
+            bank_inputs[8] = circuit.add_component<TieDown>(PinState::Low); // CLK
+            for (auto reg = 0; reg < 8; ++reg) {
+                auto *r = circuit.add_component<LS377>();
+                r->E_->feed = circuit.GND;
+                r->CLK->feed = bank_inputs[8]->Y;
+                for (auto ix = 0; ix < 8; ++ix) {
+                    r->D[ix]->feed = bank_inputs[ix]->Y;
+                }
+            }
+        },
+        [](uint64_t tick) {
+            if (tick % 8 == 0) {
+                auto bits = rng();
+                for (auto ix = 0; ix < 8; ++ix) {
+                    set_input(bank_inputs[ix], (bits >> ix) & 1);
+                }
+            }
+            set_input(bank_inputs[8], (tick / 4) % 2 == 1);
+            return true;
+        },
+    };
+}
+
+// The complete system running a microcode file until the microcode is
+// exhausted and the oscillator is switched off.
+static Scenario full_system(std::string const &microcode_file)
+{
+    auto system = std::make_shared<std::unique_ptr<System>>();
+    return {
+        "system",
+        [system, microcode_file]() {
+            *system = std::make_unique<System>(Font {});
+            auto &sys = **system;
+            sys.history_budget = 0;
+            if (auto mc_maybe = load_microcode(microcode_file); mc_maybe.is_error()) {
+                std::println(std::cerr, "{}: {}", microcode_file, mc_maybe.error());
+            } else {
+                std::swap(mc_maybe.value(), sys.microcode);
+            }
+            sys.prepare();
+        },
+        [system](uint64_t) {
+            auto &sys = **system;
+            return !sys.microcode.empty() && sys.bus->CLK->feed == sys.bus->oscillator->Y;
+        },
+        [system]() {
+            system->reset();
+        },
+    };
+}
+
+static std::string to_json(std::vector<Measurement> const &measurements)
+{
+    std::ostringstream out;
+    out << "[\n";
+    for (auto ix = 0; ix < measurements.size(); ++ix) {
+        auto const &m = measurements[ix];
+        std::print(out, R"(  {{ "name": "{}", "ticks": {}, "seconds": {:.6f}, "ticks_per_sec": {:.1f}, "ns_per_tick": {:.1f}, "evaluations_per_tick": {:.1f} }})",
+            m.name, m.ticks, m.seconds, m.ticks_per_sec(), m.ns_per_tick(), m.evaluations_per_tick);
+        out << ((ix + 1 < measurements.size()) ? ",\n" : "\n");
+    }
+    out << "]\n";
+    return out.str();
+}
+
+static std::string to_json(std::vector<ParseMeasurement> const &measurements)
+{
+    std::ostringstream out;
+    out << "[\n";
+    for (auto ix = 0; ix < measurements.size(); ++ix) {
+        auto const &m = measurements[ix];
+        std::print(out, R"(  {{ "name": "{}", "build_ms": {:.3f}, "bytes": {}, "actions": {}, "seconds": {:.6f}, "mb_per_sec": {:.2f}, "ns_per_action": {:.1f} }})",
+            m.name, m.build_ms, m.bytes, m.actions, m.seconds, m.mb_per_sec(), m.ns_per_action());
+        out << ((ix + 1 < measurements.size()) ? ",\n" : "\n");
+    }
+    out << "]\n";
+    return out.str();
+}
+
+static std::string to_json(std::vector<ElaborationStep> const &steps)
+{
+    std::ostringstream out;
+    out << "[\n";
+    for (auto ix = 0; ix < steps.size(); ++ix) {
+        auto const &s = steps[ix];
+        std::print(out, R"(  {{ "name": "{}", "ms": {:.3f}, "allocations": {}, "heap_bytes": {}, "devices": {}, "pins": {}, "closures": {}, )"
+                        R"("device_bytes": {}, "name_bytes": {}, "vector_bytes": {}, "other_bytes": {} }})",
+            s.name, s.ms, s.allocations, s.heap_bytes, s.devices, s.pins, s.closures, s.device_bytes, s.name_bytes, s.vector_bytes, s.other_bytes());
+        out << ((ix + 1 < steps.size()) ? ",\n" : "\n");
+    }
+    out << "]\n";
+    return out.str();
+}
+
+// Reads one metric per entry from a file written by to_json. Every entry is
+// on a line of its own, so no general JSON parser is needed.
+static std::unordered_map<std::string, double> read_baseline(std::string const &file_name, std::string const &metric)
+{
+    std::unordered_map<std::string, double> ret {};
+    std::ifstream                           in { file_name };
+    std::regex                              entry { R"re("name": "([^"]+)".*")re" + metric + R"re(": ([0-9.eE+-]+))re" };
+    std::string                             line;
+    while (std::getline(in, line)) {
+        std::smatch match;
+        if (std::regex_search(line, match, entry)) {
+            ret[match[1].str()] = std::stod(match[2].str());
+        }
+    }
+    return ret;
+}
+
+// Compares the metric of every entry against the baseline and returns true
+// if any of them grew by more than tolerance percent.
+static bool compare(std::vector<std::pair<std::string, double>> const &results, std::string const &file_name, std::string const &metric, double tolerance)
+{
+    auto baseline = read_baseline(file_name, metric);
+    auto ret = false;
+    for (auto const &[name, value] : results) {
+        auto it = baseline.find(name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            continue;
+        }
+        auto change = 100.0 * (value - it->second) / it->second;
+        auto regressed = change > tolerance;
+        std::println(std::cerr, "{:<16} {:>12.1f} {}, baseline {:>12.1f} ({:+.1f}%){}", name, value, metric, it->second, change,
+            regressed ? "  REGRESSION" : "");
+        ret |= regressed;
+    }
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    auto     arg_ix = Lib::parse_options(argc, const_cast<char const **>(argv));
+    uint64_t ticks { 100000 };
+    if (auto t = Lib::get_option("ticks"); t) {
+        std::from_chars(t->data(), t->data() + t->size(), ticks);
+    }
+    double tolerance { 10.0 };
+    if (auto t = Lib::get_option("tolerance"); t) {
+        std::from_chars(t->data(), t->data() + t->size(), tolerance);
+    }
+    std::string microcode_file { (arg_ix < argc) ? argv[arg_ix] : "test/test.mc" };
+
+    std::string                                 json;
+    std::string                                 metric;
+    std::vector<std::pair<std::string, double>> results {};
+    if (Lib::has_option("parse")) {
+        size_t statements { 10000 };
+        if (auto t = Lib::get_option("statements"); t) {
+            std::from_chars(t->data(), t->data() + t->size(), statements);
+        }
+        size_t repeat { 20 };
+        if (auto t = Lib::get_option("repeat"); t) {
+            std::from_chars(t->data(), t->data() + t->size(), repeat);
+        }
+        auto measurements = measure_parsing(std::string { Lib::get_option("grammar").value_or("src/App/microcode.grammar") }, statements, repeat);
+        json = to_json(measurements);
+        metric = "ns_per_action";
+        for (auto const &m : measurements) {
+            results.emplace_back(m.name, m.ns_per_action());
+        }
+    } else if (Lib::has_option("elaboration")) {
+        auto steps = measure_elaboration();
+        json = to_json(steps);
+        metric = "ms";
+        for (auto const &step : steps) {
+            results.emplace_back(step.name, step.ms);
+        }
+    } else {
+        std::vector<Scenario>    scenarios { ls382_random(), ls193_chain(), ls377_bank(), full_system(microcode_file) };
+        auto                     only = Lib::get_option_values("scenario");
+        std::vector<Measurement> measurements {};
+        for (auto const &scenario : scenarios) {
+            if (!only.empty() && std::ranges::find(only, scenario.name) == only.end()) {
+                continue;
+            }
+            measurements.push_back(run(scenario, ticks));
+        }
+        json = to_json(measurements);
+        metric = "ns_per_tick";
+        for (auto const &m : measurements) {
+            results.emplace_back(m.name, m.ns_per_tick());
+        }
+    }
+    std::cout << json;
+    if (auto output = Lib::get_option("output"); output) {
+        std::ofstream out { std::string { *output } };
+        out << json;
+    }
+
+    auto ret = 0;
+    if (auto baseline_file = Lib::get_option("baseline"); baseline_file) {
+        if (compare(results, std::string { *baseline_file }, metric, tolerance)) {
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    return Simul::main(argc, argv);
+}
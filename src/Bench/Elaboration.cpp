@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "App/ControlBus.h"
+#include "App/System.h"
+#include "Elaboration.h"
+
+// Heap use is only counted while measure_elaboration() runs, so that the
+// other benchmarks in this binary pay for no more than a flag test per
+// allocation. Block sizes are the allocator's usable sizes, so that the
+// size of the block behind any pointer can be found when it is freed.
+static std::atomic<bool>   s_counting { false };
+static std::atomic<size_t> s_allocations { 0 };
+static std::atomic<size_t> s_allocated { 0 };
+static std::atomic<size_t> s_freed { 0 };
+
+static size_t heap_block_size(void const *ptr)
+{
+#ifdef __APPLE__
+    return malloc_size(ptr);
+#else
+    return malloc_usable_size(const_cast<void *>(ptr));
+#endif
+}
+
+void *operator new(size_t size)
+{
+    auto *block = std::malloc((size > 0) ? size : 1);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    if (s_counting.load(std::memory_order_relaxed)) {
+        ++s_allocations;
+        s_allocated += heap_block_size(block);
+    }
+    return block;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    if (s_counting.load(std::memory_order_relaxed)) {
+        s_freed += heap_block_size(ptr);
+    }
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+namespace Simul {
+
+static size_t string_bytes(std::string const &s)
+{
+    return (s.capacity() > 15) ? heap_block_size(s.data()) : 0;
+}
+
+template<typename T>
+static size_t vector_bytes(std::vector<T> const &v)
+{
+    return (v.capacity() > 0) ? heap_block_size(v.data()) : 0;
+}
+
+static void account(ElaborationStep &step, Device *part)
+{
+    recurse_components(part, [&step](Device *dev) {
+        ++step.devices;
+        step.device_bytes += heap_block_size(dynamic_cast<void *>(dev));
+        step.name_bytes += string_bytes(dev->name) + string_bytes(dev->ref);
+        step.vector_bytes += vector_bytes(dev->components) + vector_bytes(dev->pins);
+        if (dev->simulate_device) {
+            ++step.closures;
+        }
+        for (auto *pin : dev->pins) {
+            ++step.pins;
+            step.name_bytes += string_bytes(pin->name);
+            step.closures += pin->on_change.has_value() + pin->on_update.has_value() + pin->on_drive.has_value();
+        }
+    });
+}
+
+std::vector<ElaborationStep> measure_elaboration()
+{
+    auto &circuit = Circuit::the();
+    circuit.initialize("Elaboration");
+    std::vector<ElaborationStep> ret {};
+    ret.reserve(32);
+    // Blocks allocated before counting started can be freed while it runs,
+    // so the live byte count can drop below where it started.
+    auto live_bytes = []() {
+        return static_cast<int64_t>(s_allocated - s_freed);
+    };
+    s_counting = true;
+    auto start = std::chrono::steady_clock::now();
+    auto allocations = s_allocations.load();
+    auto live = live_bytes();
+    System system(Font {}, [&](std::string_view part) {
+        auto now = std::chrono::steady_clock::now();
+        auto now_live = live_bytes();
+        ret.push_back({ std::string { part },
+            std::chrono::duration<double, std::milli>(now - start).count(),
+            s_allocations - allocations,
+            static_cast<size_t>(std::max<int64_t>(now_live - live, 0)) });
+        start = std::chrono::steady_clock::now();
+        allocations = s_allocations.load();
+        live = live_bytes();
+    });
+    s_counting = false;
+    for (auto &step : ret) {
+        if (step.name == system.bus->name) {
+            account(step, system.bus);
+        } else if (auto card = std::ranges::find_if(system.cards, [&step](Card const &c) { return c.circuit->name == step.name; }); card != system.cards.end()) {
+            account(step, card->circuit);
+        }
+    }
+    return ret;
+}
+
+}
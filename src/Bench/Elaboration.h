@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Simul {
+
+// Cost of building one part of the System: the backplane, a card, or the
+// final layout. Heap bytes are the bytes still allocated when the part is
+// done; the device, name and vector bytes are found by walking the part's
+// device tree afterwards. The rest is closure state, boards and graphics.
+// Closures are only counted: std::function does not expose where it keeps
+// the state it captured, so their heap bytes are part of the rest.
+struct ElaborationStep {
+    std::string name;
+    double      ms { 0.0 };
+    size_t      allocations { 0 };
+    size_t      heap_bytes { 0 };
+    size_t      devices { 0 };
+    size_t      pins { 0 };
+    size_t      closures { 0 };
+    size_t      device_bytes { 0 };
+    size_t      name_bytes { 0 };
+    size_t      vector_bytes { 0 };
+
+    [[nodiscard]] size_t other_bytes() const
+    {
+        auto accounted = device_bytes + name_bytes + vector_bytes;
+        return (heap_bytes > accounted) ? heap_bytes - accounted : 0;
+    }
+};
+
+std::vector<ElaborationStep> measure_elaboration();
+
+}
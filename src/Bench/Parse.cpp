@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <print>
+#include <random>
+#include <sstream>
+
+#include <Lib/Grammar/Parser.h>
+#include <Lib/Grammar/TableParser.h>
+#include <Lib/GrammarParser/GrammarParser.h>
+
+#include "Parse.h"
+
+namespace Simul {
+
+struct ParseBench {
+    bool     log { false };
+    uint64_t actions { 0 };
+    uint64_t checksum { 0 };
+
+    void startup(std::string_view)
+    {
+    }
+
+    void cleanup() const
+    {
+    }
+};
+
+using RuntimeParser = Lib::Parser<ParseBench>;
+using GeneratedParser = Lib::TableParser<ParseBench>;
+
+template<typename P>
+static void record(P *parser)
+{
+    ++parser->impl.actions;
+    parser->impl.checksum = parser->impl.checksum * 31 + parser->last_token.text.size();
+}
+
+}
+
+using namespace Simul;
+
+#define BenchActions(S) \
+    S(set_action)       \
+    S(set_get_reg)      \
+    S(set_put_reg)      \
+    S(set_op_bits)      \
+    S(set_address)      \
+    S(append_value)     \
+    S(set_d_value)      \
+    S(set_a_value)
+
+// The actions of microcode.grammar, once with C linkage for the runtime
+// parser to find through the dynamic linker, and once for the generated
+// tables.
+extern "C" {
+#undef S
+#define S(A)                      \
+    void A(RuntimeParser *parser) \
+    {                             \
+        record(parser);           \
+    }
+BenchActions(S)
+#undef S
+}
+
+#define S(A)                               \
+    static void A(GeneratedParser *parser) \
+    {                                      \
+        record(parser);                    \
+    }
+BenchActions(S)
+#undef S
+
+#include <Bench/parse_bench_tables.h>
+
+namespace Simul {
+
+#define S(A) { #A, static_cast<void (*)(RuntimeParser *)>(A) },
+static Lib::ActionRegistration const registrations[] = { BenchActions(S) };
+#undef S
+
+// A program using every kind of step, register and number format the
+// grammar knows about.
+static std::string generate_program(size_t statements)
+{
+    static constexpr std::array<std::string_view, 17> registers {
+        "A", "B", "C", "D", "LHS", "RHS", "IR", "Mem", "PC", "SP", "Si", "Di", "TX", "Mon", "MemAddr", "Res", "Flags"
+    };
+    std::mt19937       rng { 1 };
+    std::ostringstream out;
+    auto               number = [&rng]() {
+        auto v = rng() % 16;
+        switch (rng() % 3) {
+        case 0:
+            return std::format("{}", v);
+        case 1:
+            return std::format("0x{:x}", v);
+        default:
+            return std::format("0b{:b}", v);
+        }
+    };
+    auto reg = [&rng, &number]() {
+        return (rng() % 4 != 0) ? std::string { registers[rng() % registers.size()] } : number();
+    };
+    for (auto ix = 0; ix < statements; ++ix) {
+        switch (rng() % 4) {
+        case 0:
+        case 1:
+            std::print(out, "{} {} {} {}", (rng() % 2 != 0) ? 'D' : 'A', reg(), reg(), number());
+            break;
+        case 2: {
+            std::print(out, "M {} {{", number());
+            for (auto count = 1 + rng() % 6; count > 0; --count) {
+                std::print(out, " {}", number());
+            }
+            std::print(out, " }}");
+        } break;
+        default:
+            std::print(out, "S {} {}", number(), number());
+            break;
+        }
+        std::println(out, "{}", (rng() % 20 == 0) ? " // comment" : "");
+    }
+    return std::move(out).str();
+}
+
+template<typename P>
+static ParseMeasurement parse(P &parser, std::string_view name, double build_ms, std::string const &program, size_t repeat)
+{
+    ParseMeasurement ret { std::string { name }, build_ms };
+    auto             start = std::chrono::steady_clock::now();
+    for (auto ix = 0; ix < repeat; ++ix) {
+        parser.parse(program, "bench").must();
+    }
+    ret.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ret.bytes = program.size() * repeat;
+    ret.actions = parser.impl.actions;
+    return ret;
+}
+
+// Parses the program with the runtime grammar, where each action is
+// resolved through the dynamic linker either every time it fires or once
+// when the grammar is built, with the actions taken from a registration
+// table, and with the tables generated by grammar2cpp.
+std::vector<ParseMeasurement> measure_parsing(std::string const &grammar_file, size_t statements, size_t repeat)
+{
+    std::ifstream in { grammar_file };
+    if (!in) {
+        std::println(std::cerr, "Error opening {}", grammar_file);
+        return {};
+    }
+    std::string source { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+    auto        program = generate_program(statements);
+
+    std::vector<ParseMeasurement> ret {};
+    uint64_t                      checksum { 0 };
+    auto                          check = [&ret, &checksum](uint64_t sum) {
+        if (ret.size() == 1) {
+            checksum = sum;
+        } else if (sum != checksum) {
+            std::println(std::cerr, "{}: actions differ from {}", ret.back().name, ret.front().name);
+        }
+    };
+
+    struct Variant {
+        std::string_view name;
+        bool             late_binding;
+        bool             registered;
+    };
+    for (auto const &variant : std::array<Variant, 3> { { { "resolve", true, false }, { "bound", false, false }, { "registered", false, true } } }) {
+        auto         start = std::chrono::steady_clock::now();
+        Lib::Grammar grammar {};
+        grammar.late_binding = variant.late_binding;
+        if (variant.registered) {
+            grammar.register_actions(registrations);
+        }
+        Lib::GrammarParser gp { source };
+        if (auto e = gp.parse(grammar); e.is_error()) {
+            std::println(std::cerr, "{} Error parsing grammar: {}", gp.lexer.location, e.error());
+            return {};
+        }
+        RuntimeParser parser { grammar };
+        auto          build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ret.push_back(parse(parser, variant.name, build_ms, program, repeat));
+        check(parser.impl.checksum);
+    }
+
+    auto            start = std::chrono::steady_clock::now();
+    GeneratedParser parser { bench_tables };
+    auto            build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ret.push_back(parse(parser, "generated", build_ms, program, repeat));
+    check(parser.impl.checksum);
+    return ret;
+}
+
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Simul {
+
+// Cost of parsing microcode with one way of running the grammar: the time
+// it takes to get the parser ready, and the time per action fired while
+// parsing the same generated program a number of times.
+struct ParseMeasurement {
+    std::string name;
+    double      build_ms { 0.0 };
+    size_t      bytes { 0 };
+    size_t      actions { 0 };
+    double      seconds { 0.0 };
+
+    [[nodiscard]] double mb_per_sec() const
+    {
+        return (seconds > 0.0) ? static_cast<double>(bytes) / seconds / 1e6 : 0.0;
+    }
+
+    [[nodiscard]] double ns_per_action() const
+    {
+        return (actions > 0) ? 1e9 * seconds / static_cast<double>(actions) : 0.0;
+    }
+};
+
+std::vector<ParseMeasurement> measure_parsing(std::string const &grammar_file, size_t statements, size_t repeat);
+
+}
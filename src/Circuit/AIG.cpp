@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "AIG.h"
+
+namespace Simul {
+
+AIG::AIG()
+    : Device("AIG")
+{
+    simulate_device = [this](Device *, duration) -> void {
+        for (auto const &[pin, lit] : inputs) {
+            values[lit >> 1] = (pin->new_state == PinState::High) ? ~0ull : 0ull;
+        }
+        evaluate();
+        for (auto const &[pin, lit] : outputs) {
+            pin->new_state = (value(lit) & 1) ? PinState::High : PinState::Low;
+        }
+    };
+}
+
+AIG::Literal AIG::add_input(Pin *pin)
+{
+    auto lit = static_cast<Literal>(nodes.size() << 1);
+    nodes.push_back({ False, False });
+    values.push_back(0);
+    inputs.emplace_back(pin, lit);
+    return lit;
+}
+
+void AIG::add_output(Pin *pin, Literal lit)
+{
+    outputs.emplace_back(pin, lit);
+}
+
+AIG::Literal AIG::land(Literal a, Literal b)
+{
+    ++requested;
+    if (a > b) {
+        std::swap(a, b);
+    }
+    if (a == False || a == negate(b)) {
+        return False;
+    }
+    if (a == True || a == b) {
+        return b;
+    }
+    auto key = (static_cast<uint64_t>(a) << 32) | b;
+    if (auto it = strash.find(key); it != strash.end()) {
+        return it->second;
+    }
+    auto lit = static_cast<Literal>(nodes.size() << 1);
+    ands.push_back(nodes.size());
+    nodes.push_back({ a, b });
+    values.push_back(0);
+    strash[key] = lit;
+    return lit;
+}
+
+AIG::Literal AIG::lor(Literal a, Literal b)
+{
+    return negate(land(negate(a), negate(b)));
+}
+
+AIG::Literal AIG::lxor(Literal a, Literal b)
+{
+    return lor(land(a, negate(b)), land(negate(a), b));
+}
+
+void AIG::evaluate()
+{
+    evaluate_nodes(values);
+}
+
+void AIG::evaluate_nodes(std::vector<uint64_t> &node_values) const
+{
+    for (auto n : ands) {
+        node_values[n] = value(node_values, nodes[n].a) & value(node_values, nodes[n].b);
+    }
+}
+
+std::vector<uint64_t> AIG::evaluate(std::vector<uint64_t> const &lanes)
+{
+    assert(lanes.size() == inputs.size());
+    for (auto ix = 0; ix < inputs.size(); ++ix) {
+        values[inputs[ix].second >> 1] = lanes[ix];
+    }
+    evaluate();
+    std::vector<uint64_t> ret {};
+    ret.reserve(outputs.size());
+    for (auto const &[pin, lit] : outputs) {
+        ret.push_back(value(lit));
+    }
+    return ret;
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Device.h"
+
+namespace Simul {
+
+// Structurally hashed And-Inverter Graph. A literal is a node index shifted
+// left by one, with the low bit set if the node is inverted. Node 0 is the
+// constant false. Every node value is a 64 bit word, so 64 independent
+// stimulus lanes are evaluated at once; as a device in the circuit only lane 0
+// is used.
+struct AIG : public Device {
+    using Literal = uint32_t;
+
+    static constexpr Literal False = 0;
+    static constexpr Literal True = 1;
+
+    struct Node {
+        Literal a;
+        Literal b;
+    };
+
+    std::vector<Node>                      nodes { { False, False } };
+    std::vector<uint32_t>                  ands {};
+    std::vector<std::pair<Pin *, Literal>> inputs {};
+    std::vector<std::pair<Pin *, Literal>> outputs {};
+    std::unordered_map<uint64_t, Literal>  strash {};
+    std::vector<uint64_t>                  values { 0 };
+    size_t                                 requested { 0 };
+    size_t                                 gates { 0 };
+
+    AIG();
+
+    Literal               add_input(Pin *pin);
+    void                  add_output(Pin *pin, Literal lit);
+    Literal               land(Literal a, Literal b);
+    Literal               lor(Literal a, Literal b);
+    Literal               lxor(Literal a, Literal b);
+    void                  evaluate();
+    void                  evaluate_nodes(std::vector<uint64_t> &node_values) const;
+    std::vector<uint64_t> evaluate(std::vector<uint64_t> const &lanes);
+
+    [[nodiscard]] uint64_t value(Literal lit) const
+    {
+        return value(values, lit);
+    }
+
+    // Node values are kept in caller owned storage by evaluate_nodes,
+    // so several threads can evaluate the same graph at once.
+    [[nodiscard]] static uint64_t value(std::vector<uint64_t> const &node_values, Literal lit)
+    {
+        return node_values[lit >> 1] ^ ((lit & 1) ? ~0ull : 0ull);
+    }
+
+    static Literal negate(Literal lit)
+    {
+        return lit ^ 1;
+    }
+};
+
+}
+
+template<>
+struct std::formatter<Simul::AIG, char> {
+    template<class ParseContext>
+    constexpr ParseContext::iterator parse(ParseContext &ctx)
+    {
+        auto it = ctx.begin();
+        if (it == ctx.end())
+            return it;
+        if (*it != '}')
+            throw std::format_error("Invalid format args for AIG");
+        return it;
+    }
+
+    template<class FmtContext>
+    FmtContext::iterator format(Simul::AIG const &aig, FmtContext &ctx) const
+    {
+        std::ostringstream out;
+        out << "lower_to_aig: " << aig.gates << " gates, " << aig.inputs.size() << " inputs, "
+            << aig.requested << " AND nodes before and " << aig.ands.size() << " after structural hashing";
+        return std::ranges::copy(std::move(out).str(), ctx.out()).out;
+    }
+};
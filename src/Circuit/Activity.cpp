@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <print>
+
+#include "Activity.h"
+#include "Waveform.h"
+
+namespace Simul {
+
+Activity::Activity(Circuit &circuit)
+    : circuit(circuit)
+    , paths(pin_paths(circuit))
+{
+}
+
+size_t Activity::track()
+{
+    auto before = counters.size();
+    for (auto ix = 2; ix < circuit.pin_count; ++ix) {
+        track(&circuit.all_pins[ix]);
+    }
+    return counters.size() - before;
+}
+
+size_t Activity::track(std::string_view prefix)
+{
+    auto before = counters.size();
+    for (auto const &[pin, path] : paths) {
+        if (path.starts_with(prefix)) {
+            track(pin);
+        }
+    }
+    return counters.size() - before;
+}
+
+size_t Activity::track(Device *device)
+{
+    auto before = counters.size();
+    recurse_components(device, [this](Device *dev) {
+        for (auto *pin : dev->pins) {
+            track(pin);
+        }
+    });
+    return counters.size() - before;
+}
+
+// Tracked pins are probes, so pins tracked before the circuit is optimized
+// are kept alive. Pins that were already eliminated never change and are
+// not tracked.
+void Activity::track(Pin *pin)
+{
+    auto ix = static_cast<uint32_t>(pin - circuit.all_pins.data());
+    if (ix >= tracked.size()) {
+        tracked.resize(std::max<size_t>(circuit.pin_count, ix + 1));
+    }
+    if (tracked[ix] || !pin->live) {
+        return;
+    }
+    tracked[ix] = true;
+    counters.push_back({ ix, pin->state });
+    counters.back().since = circuit.now;
+    circuit.probes.push_back(pin);
+}
+
+void Activity::sample(duration d)
+{
+    for (auto &c : counters) {
+        auto new_state = circuit.all_pins[c.pin].new_state;
+        if (new_state == c.level) {
+            continue;
+        }
+        switch (c.level) {
+        case PinState::High:
+            c.high += d - c.since;
+            if (new_state == PinState::Low) {
+                ++c.falls;
+            }
+            break;
+        case PinState::Low:
+            c.low += d - c.since;
+            if (new_state == PinState::High) {
+                ++c.rises;
+            }
+            break;
+        default:
+            break;
+        }
+        c.level = new_state;
+        c.since = d;
+    }
+    ++ticks;
+}
+
+double Activity::coverage() const
+{
+    if (counters.empty()) {
+        return 0.0;
+    }
+    auto covered = std::ranges::count_if(counters, [](Counter const &c) { return c.rises > 0 && c.falls > 0; });
+    return static_cast<double>(covered) / static_cast<double>(counters.size());
+}
+
+void Activity::report(std::ostream &out, size_t count) const
+{
+    std::vector<Counter const *> sorted {};
+    for (auto const &c : counters) {
+        sorted.push_back(&c);
+    }
+    std::ranges::stable_sort(sorted, std::greater {}, [](Counter const *c) { return c->toggles(); });
+
+    auto print = [this, &out](Counter const *c) {
+        auto high = c->high;
+        auto low = c->low;
+        if (c->level == PinState::High) {
+            high += circuit.now - c->since;
+        } else if (c->level == PinState::Low) {
+            low += circuit.now - c->since;
+        }
+        auto total = std::chrono::duration<double>(high + low).count();
+        auto duty = (total > 0.0) ? 100.0 * std::chrono::duration<double>(high).count() / total : 0.0;
+        auto it = paths.find(&circuit.all_pins[c->pin]);
+        std::println(out, "{:>12} {:>10} {:>10} {:>6.1f}%  {}",
+            c->toggles(), c->rises, c->falls, duty, (it != paths.end()) ? it->second : circuit.all_pins[c->pin].name);
+    };
+    auto header = [&out](std::string_view title) {
+        std::println(out, "{:>12} {:>10} {:>10} {:>7}  {}", "Toggles", "Rises", "Falls", "High", title);
+    };
+
+    // The idlest pins are taken from the ones not listed as hottest.
+    auto hottest = std::min(count, sorted.size());
+    auto idlest = std::min(count, sorted.size() - hottest);
+    header("Hottest pins");
+    for (auto ix = 0; ix < hottest; ++ix) {
+        print(sorted[ix]);
+    }
+    out << "\n";
+    header("Idlest pins");
+    for (auto ix = sorted.size() - idlest; ix < sorted.size(); ++ix) {
+        print(sorted[ix]);
+    }
+    out << "\n";
+    std::println(out, "{} pins tracked over {} ticks, toggle coverage {:.1f}%", counters.size(), ticks, 100.0 * coverage());
+}
+
+}
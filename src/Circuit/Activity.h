@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Circuit.h"
+
+namespace Simul {
+
+// Toggle counts and time spent high and low for a set of pins. The circuit
+// calls sample() every tick, before the new pin states are committed.
+// Toggle coverage is the fraction of tracked pins that have both risen and
+// fallen.
+struct Activity {
+    struct Counter {
+        uint32_t pin;
+        PinState level;
+        uint64_t rises { 0 };
+        uint64_t falls { 0 };
+        duration high {};
+        duration low {};
+        duration since {};
+
+        [[nodiscard]] uint64_t toggles() const
+        {
+            return rises + falls;
+        }
+    };
+
+    Circuit                               &circuit;
+    std::unordered_map<Pin *, std::string> paths {};
+    std::vector<Counter>                   counters {};
+    std::vector<bool>                      tracked {};
+    uint64_t                               ticks { 0 };
+
+    explicit Activity(Circuit &circuit);
+    size_t track();
+    size_t track(std::string_view prefix);
+    size_t track(Device *device);
+    void   track(Pin *pin);
+    void   sample(duration d);
+    void   report(std::ostream &out, size_t count) const;
+
+    [[nodiscard]] double coverage() const;
+};
+
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fstream>
+
+#include "Checkpoint.h"
+
+namespace Simul {
+
+void Checkpoint::write_time(duration t)
+{
+    write<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - t).count());
+}
+
+duration Checkpoint::read_time()
+{
+    return now - std::chrono::duration_cast<duration>(std::chrono::nanoseconds { read<int64_t>() });
+}
+
+// PackBits: a control byte n < 128 is followed by n + 1 literal bytes, a
+// control byte n >= 128 by one byte repeated 257 - n times.
+void Checkpoint::write_packed(std::span<uint8_t const> data)
+{
+    size_t ix = 0;
+    while (ix < data.size()) {
+        auto run = 1;
+        while (ix + run < data.size() && run < 129 && data[ix + run] == data[ix]) {
+            ++run;
+        }
+        if (run > 1) {
+            write<uint8_t>(257 - run);
+            write<uint8_t>(data[ix]);
+            ix += run;
+            continue;
+        }
+        auto literal = 1;
+        while (ix + literal < data.size() && literal < 128
+            && (ix + literal + 1 >= data.size() || data[ix + literal] != data[ix + literal + 1])) {
+            ++literal;
+        }
+        write<uint8_t>(literal - 1);
+        bytes.insert(bytes.end(), data.begin() + ix, data.begin() + ix + literal);
+        ix += literal;
+    }
+}
+
+// Fails if the packed data runs past the end of the image or unpacks to
+// more than data.size() bytes.
+bool Checkpoint::read_packed(std::span<uint8_t> data)
+{
+    size_t ix = 0;
+    while (ix < data.size() && !failed) {
+        auto control = read<uint8_t>();
+        if (control < 128) {
+            if (pos + control + 1 > bytes.size() || ix + control + 1 > data.size()) {
+                failed = true;
+                break;
+            }
+            memcpy(data.data() + ix, bytes.data() + pos, control + 1);
+            pos += control + 1;
+            ix += control + 1;
+        } else {
+            auto run = 257 - control;
+            auto value = read<uint8_t>();
+            if (ix + run > data.size()) {
+                failed = true;
+                break;
+            }
+            memset(data.data() + ix, value, run);
+            ix += run;
+        }
+    }
+    return !failed;
+}
+
+void Checkpoint::write_pages(MemoryPages pages)
+{
+    write(static_cast<uint32_t>(memories.size()));
+    page_bytes += pages.fresh * MemoryPages::PageSize;
+    memories.push_back(std::move(pages));
+}
+
+MemoryPages const *Checkpoint::read_pages()
+{
+    auto ix = read<uint32_t>();
+    if (failed || ix >= memories.size()) {
+        failed = true;
+        return nullptr;
+    }
+    return &memories[ix];
+}
+
+// A checkpoint file is the size of the byte image, the byte image, and the
+// memory snapshots with every page PackBits compressed.
+bool Checkpoint::save(std::string_view path) const
+{
+    Checkpoint tail {};
+    tail.write(static_cast<uint32_t>(memories.size()));
+    for (auto const &memory : memories) {
+        tail.write(static_cast<uint32_t>(memory.pages.size()));
+        for (auto const &page : memory.pages) {
+            tail.write_packed(*page);
+        }
+    }
+    std::ofstream out { std::string { path }, std::ios::binary };
+    auto          size = static_cast<uint64_t>(bytes.size());
+    out.write(reinterpret_cast<char const *>(&size), sizeof(size));
+    out.write(reinterpret_cast<char const *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    out.write(reinterpret_cast<char const *>(tail.bytes.data()), static_cast<std::streamsize>(tail.bytes.size()));
+    return out.good();
+}
+
+bool Checkpoint::load(std::string_view path)
+{
+    std::ifstream in { std::string { path }, std::ios::binary };
+    if (!in) {
+        return false;
+    }
+    Checkpoint file {};
+    file.bytes.assign(std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {});
+    if (file.bytes.size() < sizeof(uint64_t) + sizeof(uint32_t)) {
+        return false;
+    }
+    auto size = file.read<uint64_t>();
+    if (size > file.bytes.size() - file.pos - sizeof(uint32_t)) {
+        return false;
+    }
+    auto image_start = file.pos;
+    file.pos += size;
+
+    // Every page takes at least one byte of the file, so corrupt counts run
+    // into the end of the file instead of allocating without bound.
+    std::vector<MemoryPages> loaded {};
+    for (auto count = file.read<uint32_t>(); count > 0 && !file.failed; --count) {
+        auto &memory = loaded.emplace_back();
+        for (auto pages = file.read<uint32_t>(); pages > 0 && !file.failed; --pages) {
+            auto page = std::make_shared<MemoryPages::Page>();
+            if (!file.read_packed(*page)) {
+                break;
+            }
+            memory.pages.push_back(std::move(page));
+        }
+        memory.fresh = memory.pages.size();
+    }
+    if (file.failed || file.pos != file.bytes.size()) {
+        return false;
+    }
+    bytes.assign(file.bytes.begin() + image_start, file.bytes.begin() + image_start + size);
+    memories = std::move(loaded);
+    page_bytes = 0;
+    for (auto const &memory : memories) {
+        page_bytes += memory.fresh * MemoryPages::PageSize;
+    }
+    pos = 0;
+    failed = false;
+    return true;
+}
+
+uint8_t pack_pin(Pin const &pin)
+{
+    uint8_t ret = 0;
+    switch (pin.state) {
+    case PinState::Low:
+        break;
+    case PinState::High:
+        ret = 1;
+        break;
+    case PinState::Z:
+        ret = 2;
+        break;
+    }
+    return ret | (pin.driving ? 0x04 : 0x00);
+}
+
+void unpack_pin(Pin &pin, uint8_t bits)
+{
+    static constexpr PinState states[] = { PinState::Low, PinState::High, PinState::Z, PinState::Z };
+    pin.state = pin.new_state = states[bits & 0x03];
+    pin.driving = pin.new_driving = (bits & 0x04) != 0;
+}
+
+static uint32_t device_count(Circuit &circuit)
+{
+    uint32_t ret = 0;
+    recurse_components(&circuit, [&ret](Device *) { ++ret; });
+    return ret;
+}
+
+Checkpoint save_checkpoint(Circuit &circuit)
+{
+    Checkpoint ret { .now = circuit.now };
+    ret.write(Checkpoint::Magic);
+    ret.write(Checkpoint::Version);
+    ret.write(static_cast<uint32_t>(circuit.pin_count));
+    ret.write(device_count(circuit));
+    std::vector<uint8_t> pins((circuit.pin_count + 1) / 2);
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        pins[ix / 2] |= pack_pin(circuit.all_pins[ix]) << (4 * (ix % 2));
+    }
+    ret.write_packed(pins);
+    recurse_components(&circuit, [&ret](Device *dev) { dev->save(ret); });
+    return ret;
+}
+
+// Returns false if the checkpoint was not taken from this circuit, or is
+// damaged. In the latter case the circuit may be partially restored.
+bool restore_checkpoint(Circuit &circuit, Checkpoint &checkpoint)
+{
+    checkpoint.pos = 0;
+    checkpoint.failed = false;
+    checkpoint.now = circuit.now;
+    if (checkpoint.bytes.size() < 16
+        || checkpoint.read<uint32_t>() != Checkpoint::Magic
+        || checkpoint.read<uint32_t>() != Checkpoint::Version
+        || checkpoint.read<uint32_t>() != circuit.pin_count
+        || checkpoint.read<uint32_t>() != device_count(circuit)) {
+        return false;
+    }
+    std::vector<uint8_t> pins((circuit.pin_count + 1) / 2);
+    if (!checkpoint.read_packed(pins)) {
+        return false;
+    }
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        unpack_pin(circuit.all_pins[ix], pins[ix / 2] >> (4 * (ix % 2)));
+    }
+    recurse_components(&circuit, [&checkpoint](Device *dev) { dev->restore(checkpoint); });
+    return !checkpoint.failed;
+}
+
+}
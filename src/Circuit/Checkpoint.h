@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "Circuit.h"
+#include "MemoryPages.h"
+
+namespace Simul {
+
+// Binary image of the state of a running circuit. Pins are packed two to a
+// byte, byte arrays are PackBits compressed, and device-private times are
+// stored relative to the circuit's clock so a checkpoint can be restored at
+// any later point in time. Memory contents are kept out of the byte image as
+// MemoryPages snapshots, so that checkpoints share the pages that did not
+// change between them; saving to a file packs them after the byte image.
+// Reads never run past the end of the image: a read that would sets failed
+// and returns zeros, so a truncated or corrupt image is refused by load() and
+// restore_checkpoint() instead of being trusted.
+struct Checkpoint {
+    static constexpr uint32_t Magic = 0x434D4953; // "SIMC"
+    static constexpr uint32_t Version = 2;
+
+    std::vector<uint8_t>     bytes {};
+    size_t                   pos { 0 };
+    duration                 now {};
+    std::vector<MemoryPages> memories {};
+    size_t                   page_bytes { 0 };
+    bool                     failed { false };
+
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    void write(T const &value)
+    {
+        auto at = bytes.size();
+        bytes.resize(at + sizeof(T));
+        memcpy(bytes.data() + at, &value, sizeof(T));
+    }
+
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    T read()
+    {
+        T ret {};
+        if (sizeof(T) > bytes.size() - pos) {
+            failed = true;
+            pos = bytes.size();
+            return ret;
+        }
+        memcpy(&ret, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return ret;
+    }
+
+    void     write_time(duration t);
+    duration read_time();
+    void     write_packed(std::span<uint8_t const> data);
+    bool     read_packed(std::span<uint8_t> data);
+    void     write_pages(MemoryPages pages);
+    bool     save(std::string_view path) const;
+    bool     load(std::string_view path);
+
+    MemoryPages const *read_pages();
+
+    // Bytes taken by this checkpoint on top of the memory pages it shares
+    // with the checkpoints taken before it.
+    [[nodiscard]] size_t footprint() const
+    {
+        return bytes.size() + page_bytes;
+    }
+};
+
+uint8_t    pack_pin(Pin const &pin);
+void       unpack_pin(Pin &pin, uint8_t bits);
+Checkpoint save_checkpoint(Circuit &circuit);
+bool       restore_checkpoint(Circuit &circuit, Checkpoint &checkpoint);
+
+}
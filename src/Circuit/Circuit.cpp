@@ -4,8 +4,12 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include "Activity.h"
 #include "Circuit.h"
+#include "History.h"
+#include "Profiler.h"
 #include <algorithm>
+#include <unordered_map>
 
 namespace Simul {
 
@@ -17,6 +21,17 @@ void Circuit::initialize(std::string const &name)
         delete c;
     }
     components.clear();
+    probes.clear();
+    nets.clear();
+    nets_valid = false;
+    net_stats = {};
+    history = nullptr;
+    profiler = nullptr;
+    activity = nullptr;
+    on_tick.clear();
+    now = {};
+    ticks = 0;
+    paused = false;
     pin_count = 2;
 }
 
@@ -45,23 +60,20 @@ Pin *Circuit::allocate_pin(int nr, std::string const &pin_name, PinState state)
 {
     assert(pin_count < all_pins.size());
     auto *ret = &all_pins[pin_count++];
+    nets_valid = false;
     return new (ret) Pin { nr, pin_name, state };
 }
 
-void recurse_components(Device *dev, auto callback)
-{
-    for (auto *c : dev->components) {
-        recurse_components(c, callback);
-    }
-    callback(dev);
-};
-
+// Returns the number of pins that change state in this tick. Pins are
+// counted when the tick is committed, so changes made by devices and by net
+// resolution count as well as changes that come in through feeds.
 size_t Circuit::simulate(duration d)
 {
     size_t ret = 0;
+    now = d;
     for (auto ix = pin_count - 1; ix < pin_count; --ix) {
-        if (all_pins[ix].update(d)) {
-            ++ret;
+        if (all_pins[ix].live) {
+            all_pins[ix].update(d);
         }
     }
     for (auto ix = 0; ix < pin_count; ++ix) {
@@ -78,31 +90,107 @@ size_t Circuit::simulate(duration d)
             (*dev->simulate_device)(dev, d);
         }
     };
-    recurse_components(this, [d](Device *dev) {
-        if (dev->simulate_device.has_value()) {
-            (dev->simulate_device.value())(dev, d);
-        }
-    });
+    if (profiler != nullptr) {
+        profiler->simulate(d);
+    } else {
+        recurse_components(this, [d](Device *dev) {
+            if (dev->live && dev->simulate_device.has_value()) {
+                (dev->simulate_device.value())(dev, d);
+            }
+        });
+    }
     for (auto ix = 0; ix < pin_count; ++ix) {
         auto &p = all_pins[ix];
         if (p.on_drive) {
             (*p.on_drive)(&p, d);
         }
-        if (p.new_driving && p.drive && p.new_state != PinState::Z) {
-            p.drive->new_state = p.new_state;
+    }
+    resolve_nets();
+    if (activity != nullptr) {
+        activity->sample(d);
+    }
+    if (history != nullptr) {
+        for (auto ix = 0; ix < pin_count; ++ix) {
+            auto &p = all_pins[ix];
+            if (p.state != p.new_state || p.driving != p.new_driving) {
+                p.state = p.new_state;
+                p.driving = p.new_driving;
+                history->record(ix, p);
+                ++ret;
+            }
+        }
+        history->end_tick();
+    } else {
+        for (auto ix = 0; ix < pin_count; ++ix) {
+            auto &p = all_pins[ix];
+            ret += (p.state != p.new_state || p.driving != p.new_driving) ? 1 : 0;
+            p.state = p.new_state;
+            p.driving = p.new_driving;
         }
     }
-    for (auto ix = 0; ix < pin_count; ++ix) {
-        all_pins[ix].state = all_pins[ix].new_state;
-        all_pins[ix].driving = all_pins[ix].new_driving;
+    for (auto &handler : on_tick) {
+        handler(this, d);
     }
+    ++ticks;
     return ret;
 }
 
-std::thread Circuit::start_simulation()
+void Circuit::build_nets()
 {
-    std::unique_lock lock(yield_mutex);
+    std::unordered_map<Pin *, size_t> net_of {};
+    nets.clear();
+    for (auto ix = 0; ix < pin_count; ++ix) {
+        auto &p = all_pins[ix];
+        if (p.drive == nullptr) {
+            continue;
+        }
+        auto [it, inserted] = net_of.try_emplace(p.drive, nets.size());
+        if (inserted) {
+            nets.push_back(Net { p.drive });
+        }
+        nets[it->second].drivers.push_back(&p);
+    }
+    net_stats.nets = nets.size();
+    nets_valid = true;
+}
+
+// Every net takes the value of its active drivers. Drivers that disagree are
+// counted as contention, and the one allocated last wins. A net without an
+// active driver keeps whatever its feed gave it, and counts as floating when
+// it was driven the tick before.
+void Circuit::resolve_nets()
+{
+    if (!nets_valid) {
+        build_nets();
+    }
+    for (auto &net : nets) {
+        auto value = PinState::Z;
+        auto conflict = false;
+        for (auto *driver : net.drivers) {
+            if (!driver->new_driving || driver->new_state == PinState::Z) {
+                continue;
+            }
+            conflict |= value != PinState::Z && value != driver->new_state;
+            value = driver->new_state;
+        }
+        if (conflict) {
+            ++net_stats.contention;
+            net_stats.last_contention = net.pin;
+        }
+        if (value != PinState::Z) {
+            net.pin->new_state = value;
+            net.driven = true;
+        } else if (net.driven) {
+            ++net_stats.floating;
+            net.driven = false;
+        }
+    }
+}
 
+// Runs the initial update and evaluation of every pin and device and syncs
+// the new states, so that simulate() can be called directly.
+void Circuit::prepare()
+{
     for (auto ix = 0; ix < pin_count; ++ix) {
         Pin &p = all_pins[ix];
         if (p.on_update) {
@@ -121,18 +209,31 @@ std::thread Circuit::start_simulation()
         all_pins[ix].new_state = all_pins[ix].state;
         all_pins[ix].new_driving = all_pins[ix].driving;
     }
+}
+
+std::thread Circuit::start_simulation()
+{
+    std::unique_lock lock(yield_mutex);
 
+    prepare();
     std::thread t { [&]() {
         if (status != SimStatus::Unstarted && status != SimStatus::Done) {
             return;
         }
         auto    start = std::chrono::high_resolution_clock::now();
+        auto    last = start;
         status = SimStatus::Starting;
         do {
             {
                 std::unique_lock lock(yield_mutex);
                 auto             now { std::chrono::high_resolution_clock::now() };
-                simulate(now - start);
+                // Simulated time stands still while the circuit is paused.
+                if (paused) {
+                    start += now - last;
+                } else {
+                    simulate(now - start);
+                }
+                last = now;
                 if (status == SimStatus::Starting) {
                     status = SimStatus::Started;
                 }
@@ -146,12 +247,57 @@ std::thread Circuit::start_simulation()
     return t;
 }
 
+// Without a simulation thread, yielding runs the circuit until it settles.
 void Circuit::yield()
 {
+    if (status == SimStatus::Unstarted || status == SimStatus::Done) {
+        settle();
+        return;
+    }
     std::unique_lock lock(yield_mutex);
     yielder.wait(lock);
 }
 
+// The synchronous API below drives the circuit from the calling thread,
+// advancing the simulated time by tick_length every tick. prepare() must have
+// been called first. step() and run_until() return early when the circuit
+// gets paused, e.g. by a watchpoint.
+size_t Circuit::step(size_t count)
+{
+    size_t ret = 0;
+    for (auto ix = 0; ix < count && !paused; ++ix) {
+        ret += simulate(now + tick_length);
+    }
+    return ret;
+}
+
+// Steps until a tick in which no pin changes. Returns the number of ticks
+// taken, or max_ticks if the circuit did not settle, e.g. because it is
+// oscillating.
+size_t Circuit::settle(size_t max_ticks)
+{
+    for (auto ix = 0; ix < max_ticks; ++ix) {
+        if (simulate(now + tick_length) == 0) {
+            return ix + 1;
+        }
+    }
+    return max_ticks;
+}
+
+bool Circuit::run_until(std::function<bool()> const &predicate, size_t max_ticks)
+{
+    for (auto ix = 0; ix < max_ticks; ++ix) {
+        if (predicate()) {
+            return true;
+        }
+        if (paused) {
+            return false;
+        }
+        simulate(now + tick_length);
+    }
+    return predicate();
+}
+
 Circuit Circuit::_the {};
 
 Circuit &Circuit::the()
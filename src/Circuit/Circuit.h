@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <concepts>
 #include <condition_variable>
 #include <thread>
@@ -14,6 +15,21 @@
 
 namespace Simul {
 
+// A pin driven by one or more other pins through their drive pointers. The
+// net is resolved once per tick, after all devices have been simulated.
+struct Net {
+    Pin               *pin;
+    std::vector<Pin *> drivers {};
+    bool               driven { false };
+};
+
+struct NetStats {
+    size_t nets { 0 };
+    size_t contention { 0 };
+    size_t floating { 0 };
+    Pin   *last_contention { nullptr };
+};
+
 struct Circuit : public Device {
     enum class SimStatus {
         Unstarted,
@@ -30,15 +46,33 @@ struct Circuit : public Device {
     std::condition_variable    yielder {};
     Pin                       *VCC { nullptr };
     Pin                       *GND { nullptr };
+    std::vector<Pin *>         probes {};
+    std::vector<Net>           nets {};
+    bool                       nets_valid { false };
+    NetStats                   net_stats {};
+    duration                   now {};
+    duration                   tick_length { std::chrono::milliseconds(1) };
+    uint64_t                   ticks { 0 };
+    std::atomic<bool>          paused { false };
+    struct History            *history { nullptr };
+    struct Profiler           *profiler { nullptr };
+    struct Activity           *activity { nullptr };
+    std::vector<Handler>       on_tick {};
 
     void        initialize(std::string const &name = "");
     void        start();
     void        stop();
     void        done();
+    void        prepare();
     std::thread start_simulation();
     void        yield();
     size_t      simulate(duration d);
+    size_t      step(size_t count = 1);
+    size_t      settle(size_t max_ticks = 1000);
+    bool        run_until(std::function<bool()> const &predicate, size_t max_ticks = 100000);
     Pin        *allocate_pin(int nr, std::string const &pin_name, PinState state = PinState::Z);
+    void        build_nets();
+    void        resolve_nets();
 
     static Circuit &the();
 
@@ -55,17 +89,51 @@ private:
     static Circuit _the;
 };
 
+void recurse_components(Device *dev, auto callback)
+{
+    for (auto *c : dev->components) {
+        recurse_components(c, callback);
+    }
+    callback(dev);
+}
+
+// Runs the test_setup/test_run pair of D on a fresh circuit, synchronously.
 template<typename D>
     requires std::derived_from<D, Device>
 void test_device()
 {
     Circuit &circuit = Circuit::the();
-    auto    *chip = circuit.add_component<D>();
+    circuit.initialize();
+    auto *chip = circuit.add_component<D>();
     chip->test_setup(circuit);
-    auto t = circuit.start_simulation();
+    circuit.prepare();
+    circuit.settle();
     chip->test_run(circuit);
-    circuit.stop();
-    t.join();
 }
 
 }
+
+template<>
+struct std::formatter<Simul::NetStats, char> {
+    template<class ParseContext>
+    constexpr ParseContext::iterator parse(ParseContext &ctx)
+    {
+        auto it = ctx.begin();
+        if (it == ctx.end())
+            return it;
+        if (*it != '}')
+            throw std::format_error("Invalid format args for NetStats");
+        return it;
+    }
+
+    template<class FmtContext>
+    FmtContext::iterator format(Simul::NetStats const &stats, FmtContext &ctx) const
+    {
+        std::ostringstream out;
+        out << stats.nets << " nets, " << stats.contention << " contention events, " << stats.floating << " floating events";
+        if (stats.last_contention != nullptr) {
+            out << " (last contention on " << stats.last_contention->name << ")";
+        }
+        return std::ranges::copy(std::move(out).str(), ctx.out()).out;
+    }
+};
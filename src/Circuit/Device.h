@@ -25,6 +25,7 @@ struct Device {
     std::vector<Device *>  components;
     Device                *parent { nullptr };
     std::optional<Handler> simulate_device {};
+    bool                   live { true };
 
     explicit Device(std::string name, std::string ref = "")
         : name(std::move(name))
@@ -70,6 +71,14 @@ struct Device {
     {
     }
 
+    virtual void save(struct Checkpoint &) const
+    {
+    }
+
+    virtual void restore(struct Checkpoint &)
+    {
+    }
+
     virtual void test_run(struct Circuit &)
     {
     }
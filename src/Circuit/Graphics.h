@@ -45,6 +45,11 @@ struct AbstractPackage {
     virtual void handle_input()
     {
     }
+
+    [[nodiscard]] virtual std::vector<Pin *> package_pins() const
+    {
+        return {};
+    }
 };
 
 template<size_t S>
@@ -67,6 +72,11 @@ struct Package : public AbstractPackage {
         rect.x += x_off;
         rect.y += y_off;
     }
+
+    [[nodiscard]] std::vector<Pin *> package_pins() const override
+    {
+        return { pins.begin(), pins.end() };
+    }
 };
 
 inline Color pin_color(Pin *pin)
@@ -523,6 +533,19 @@ struct Board {
         }
     }
 
+    [[nodiscard]] std::vector<Pin *> observed_pins() const
+    {
+        std::vector<Pin *> ret {};
+        for (auto const &p : packages) {
+            for (auto *pin : p->package_pins()) {
+                if (pin != nullptr) {
+                    ret.push_back(pin);
+                }
+            }
+        }
+        return ret;
+    }
+
     void handle_input()
     {
         for (auto const &p : packages) {
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include "History.h"
+
+namespace Simul {
+
+History::History(Circuit &circuit, size_t budget)
+    : circuit(circuit)
+    , budget(budget)
+{
+    ring.resize(std::max<size_t>(budget / 2 / sizeof(Event), 1024));
+}
+
+void History::end_tick()
+{
+    for (auto ix = 0; ix < values.size(); ++ix) {
+        if (*values[ix] != last_values[ix]) {
+            last_values[ix] = *values[ix];
+            push({ static_cast<uint32_t>(last_values[ix]), static_cast<uint16_t>(ix), Kind::Value, 0 });
+        }
+    }
+    ++ticks;
+    push({ static_cast<uint32_t>(ticks), 0, Kind::Tick, 0 });
+    if (ticks % keyframe_interval == 0 || keyframes.empty()) {
+        take_keyframe();
+    }
+}
+
+void History::take_keyframe()
+{
+    auto &keyframe = keyframes.emplace_back(ticks, written, save_checkpoint(circuit), last_values);
+    keyframe_bytes += keyframe.checkpoint.footprint();
+    auto first = (written > ring.size()) ? written - ring.size() : 0;
+    while (keyframes.size() > 1 && (keyframe_bytes > budget / 2 || keyframes.front().seq < first)) {
+        keyframe_bytes -= keyframes.front().checkpoint.footprint();
+        keyframes.pop_front();
+    }
+}
+
+// The oldest tick that can still be reached: the oldest keyframe whose
+// events have not been overwritten yet.
+uint64_t History::oldest() const
+{
+    auto first = (written > ring.size()) ? written - ring.size() : 0;
+    for (auto const &keyframe : keyframes) {
+        if (keyframe.seq >= first) {
+            return keyframe.tick;
+        }
+    }
+    return ticks;
+}
+
+// Moves the circuit, the tracked values and the circuit's tick count to
+// where they were after the given tick. The history past that tick is
+// discarded, so the simulation continues from there.
+bool History::seek(uint64_t tick)
+{
+    if (tick > ticks || tick < oldest()) {
+        return false;
+    }
+    auto it = std::find_if(keyframes.rbegin(), keyframes.rend(), [tick](Keyframe const &keyframe) {
+        return keyframe.tick <= tick;
+    });
+    assert(it != keyframes.rend());
+    if (!restore_checkpoint(circuit, it->checkpoint)) {
+        return false;
+    }
+    for (auto ix = 0; ix < values.size(); ++ix) {
+        *values[ix] = it->values[ix];
+    }
+    auto seq = it->seq;
+    for (auto t = it->tick; t < tick; ++seq) {
+        auto const &event = ring[seq % ring.size()];
+        switch (event.kind) {
+        case Kind::Tick:
+            ++t;
+            break;
+        case Kind::Pin:
+            unpack_pin(circuit.all_pins[event.target], event.value);
+            break;
+        case Kind::Memory:
+            regions[event.region][event.target] = event.value;
+            region_pages[event.region]->touch(event.target);
+            break;
+        case Kind::Value:
+            *values[event.region] = event.target;
+            break;
+        }
+    }
+    for (auto ix = 0; ix < values.size(); ++ix) {
+        last_values[ix] = *values[ix];
+    }
+    circuit.ticks -= ticks - tick;
+    written = seq;
+    ticks = tick;
+    while (!keyframes.empty() && keyframes.back().tick > tick) {
+        keyframe_bytes -= keyframes.back().checkpoint.footprint();
+        keyframes.pop_back();
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "Checkpoint.h"
+
+namespace Simul {
+
+// Record of the recent past of a circuit. Every tick appends the pins that
+// changed and the memory bytes that were written to a ring buffer; every
+// keyframe_interval ticks a checkpoint is taken. Seeking restores the nearest
+// keyframe before the requested tick and replays the ring buffer up to it.
+// The ring buffer and the keyframes together stay within the given budget.
+// State that lives outside the circuit but has to move along with it, like
+// the step counter of a microcode sequencer, is tracked as a value: changes
+// are recorded in the ring buffer as 32-bit numbers, and every keyframe
+// keeps a copy.
+struct History {
+    enum class Kind : uint8_t {
+        Tick,
+        Pin,
+        Memory,
+        Value,
+    };
+
+    struct Event {
+        uint32_t target;
+        uint16_t region;
+        Kind     kind;
+        uint8_t  value;
+    };
+
+    struct Keyframe {
+        uint64_t   tick;
+        uint64_t   seq;
+        Checkpoint          checkpoint;
+        std::vector<size_t> values;
+    };
+
+    Circuit                        &circuit;
+    size_t                          budget;
+    uint64_t                        keyframe_interval { 4096 };
+    std::vector<Event>              ring {};
+    uint64_t                        written { 0 };
+    uint64_t                        ticks { 0 };
+    std::deque<Keyframe>            keyframes {};
+    size_t                          keyframe_bytes { 0 };
+    std::vector<std::span<uint8_t>> regions {};
+    std::vector<PageTracker *>      region_pages {};
+    std::vector<size_t *>           values {};
+    std::vector<size_t>             last_values {};
+
+    History(Circuit &circuit, size_t budget);
+
+    template<typename M>
+    void track(M *memory)
+    {
+        auto region = static_cast<uint16_t>(regions.size());
+        regions.emplace_back(memory->bytes);
+        region_pages.push_back(&memory->pages);
+        memory->on_write = [this, region](uint16_t addr, uint8_t value) -> void {
+            push({ addr, region, Kind::Memory, value });
+        };
+    }
+
+    void track_value(size_t &value)
+    {
+        values.push_back(&value);
+        last_values.push_back(value);
+    }
+
+    void record(size_t pin_index, Pin const &pin)
+    {
+        push({ static_cast<uint32_t>(pin_index), 0, Kind::Pin, pack_pin(pin) });
+    }
+
+    void end_tick();
+    bool seek(uint64_t tick);
+
+    [[nodiscard]] uint64_t oldest() const;
+
+private:
+    void push(Event event)
+    {
+        ring[written++ % ring.size()] = event;
+    }
+
+    void take_keyframe();
+};
+
+}
@@ -37,13 +37,13 @@ void SRLatch::test_setup(Circuit &)
     R_->state = PinState::High;
 }
 
-void SRLatch::test_run(Circuit &)
+void SRLatch::test_run(Circuit &circuit)
 {
     assert(Q->state != Q_->state);
     auto q = Q->state;
-    S_->state = PinState::High;
-    R_->state = PinState::Low;
-    std::this_thread::sleep_for(5ms);
+    S_->new_state = PinState::High;
+    R_->new_state = PinState::Low;
+    circuit.yield();
     assert(Q->state != q);
 }
 
@@ -81,19 +81,28 @@ DFlipFlop::DFlipFlop()
     output->R_Gate->pin(3)->feed = CLR_;
 }
 
+// Forces the output latch into the given state, as if it had been clocked
+// in. Only meaningful while the clock is low and both input latches are idle.
+void DFlipFlop::load(PinState value)
+{
+    Q->state = Q->new_state = value;
+    Q_->state = Q_->new_state = !value;
+}
+
 void DFlipFlop::test_run(Circuit &circuit)
 {
-    CLK->state = PinState::Low;
-    D->state = PinState::High;
+    CLK->new_state = PinState::Low;
+    D->new_state = PinState::High;
     circuit.yield();
-    CLK->state = PinState::High;
+    CLK->new_state = PinState::High;
     circuit.yield();
     assert(Q->on());
     assert(Q_->off());
-    CLK->state = PinState::Low;
+    CLK->new_state = PinState::Low;
+    circuit.yield();
+    D->new_state = PinState::Low;
     circuit.yield();
-    D->state = PinState::Low;
-    CLK->state = PinState::High;
+    CLK->new_state = PinState::High;
     circuit.yield();
     assert(Q->off());
     assert(Q_->on());
@@ -170,35 +179,50 @@ void DFlipFlop_test(Board &board)
     connect(latch->Q, L);
 }
 
+// Master-slave: the primary latch follows J and K while CLK is low, and the
+// secondary latch copies the primary while CLK is high, so the outputs only
+// change on the rising edge. SET_ and CLR_ act on both latches directly.
 JKFlipFlop::JKFlipFlop()
     : Device("J/K Flip-flop with set and clear")
 {
+    clock = add_component<Inverter>();
     J_gate = add_component<NandGate>(3);
     K_gate = add_component<NandGate>(3);
-    secondary = add_component<SRLatch>();
-    clr = add_component<AndGate>();
-    set = add_component<AndGate>();
+    primary = add_component<SRLatch>(2);
+    set = add_component<NandGate>();
+    clr = add_component<NandGate>();
+    secondary = add_component<SRLatch>(2);
 
     Q = secondary->Q;
     Q_ = secondary->Q_;
-    assert(Q == secondary->Q);
-
-    CLK = J_gate->A1;
-    J = J_gate->A2;
-    J_gate->pin(3)->feed = secondary->Q_;
+    for (auto *latch : { primary, secondary }) {
+        latch->S_->state = latch->R_->state = PinState::High;
+        latch->S_Gate->pin(3)->state = latch->R_Gate->pin(3)->state = PinState::High;
+        latch->Q->state = latch->R_Gate->A2->state = PinState::Low;
+        latch->Q_->state = latch->S_Gate->A2->state = PinState::High;
+    }
 
-    SET_ = set->A1;
+    CLK = clock->A;
+    SET_ = secondary->S_Gate->pin(3);
     SET_->state = PinState::High;
-    set->A2->feed = J_gate->Y;
-
-    K_gate->A1->feed = CLK;
-    K = K_gate->A2;
-    K_gate->pin(3)->feed = secondary->Q;
-
-    CLR_ = clr->A1;
+    CLR_ = secondary->R_Gate->pin(3);
     CLR_->state = PinState::High;
-    clr->A2->feed = J_gate->Y;
+    primary->S_Gate->pin(3)->feed = SET_;
+    primary->R_Gate->pin(3)->feed = CLR_;
 
+    J_gate->A1->feed = clock->Y;
+    J = J_gate->A2;
+    J_gate->pin(3)->feed = Q_;
+    K_gate->A1->feed = clock->Y;
+    K = K_gate->A2;
+    K_gate->pin(3)->feed = Q;
+    primary->S_->feed = J_gate->Y;
+    primary->R_->feed = K_gate->Y;
+
+    set->A1->feed = CLK;
+    set->A2->feed = primary->Q;
+    clr->A1->feed = CLK;
+    clr->A2->feed = primary->Q_;
     secondary->S_->feed = set->Y;
     secondary->R_->feed = clr->Y;
 }
@@ -209,39 +233,41 @@ void JKFlipFlop::test_setup(Circuit &circuit)
 
 void JKFlipFlop::test_run(Circuit &circuit)
 {
-    CLR_->state = SET_->state = PinState::High;
-    CLK->state = PinState::Low;
-    J->state = PinState::High;
-    K->state = PinState::Low;
+    CLR_->new_state = SET_->new_state = PinState::High;
+    CLK->new_state = PinState::Low;
+    J->new_state = PinState::High;
+    K->new_state = PinState::Low;
     circuit.yield();
 
-    CLK->state = PinState::High;
+    CLK->new_state = PinState::High;
     circuit.yield();
 
     assert(Q->on());
-    CLK->state = PinState::Low;
+    CLK->new_state = PinState::Low;
     circuit.yield();
 
     assert(Q->on());
-    J->state = PinState::High;
-    K->state = PinState::High;
-    CLK->state = PinState::High;
+    J->new_state = PinState::High;
+    K->new_state = PinState::High;
+    circuit.yield();
+    CLK->new_state = PinState::High;
     circuit.yield();
 
     assert(Q->off());
-    CLK->state = PinState::Low;
+    CLK->new_state = PinState::Low;
     circuit.yield();
 
     assert(Q->off());
-    CLK->state = PinState::High;
+    CLK->new_state = PinState::High;
     circuit.yield();
 
     assert(Q->on());
-    SET_->state = PinState::Low;
+    SET_->new_state = PinState::Low;
     circuit.yield();
 
     assert(Q->on());
-    CLR_->state = PinState::Low;
+    SET_->new_state = PinState::High;
+    CLR_->new_state = PinState::Low;
     circuit.yield();
 
     assert(Q->off());
@@ -80,12 +80,12 @@ struct GatedSRLatch : public Device {
     {
         assert(Q->state != Q_->state);
         auto q = Q->state;
-        E->state = PinState::Low;
-        S_[0]->state = PinState::High;
-        R_[0]->state = PinState::Low;
+        E->new_state = PinState::Low;
+        S_[0]->new_state = PinState::High;
+        R_[0]->new_state = PinState::Low;
         circuit.yield();
         assert(Q->state == q);
-        E->state = PinState::High;
+        E->new_state = PinState::High;
         circuit.yield();
         assert(Q->state != q);
     }
@@ -108,6 +108,7 @@ struct DFlipFlop : public Device {
     Pin *Q_;
 
     DFlipFlop();
+    void load(PinState value);
     void test_run(Circuit &) override;
 
 private:
@@ -135,6 +136,8 @@ struct DFlipFlopIcon : Package<3> {
  *  H    H    ⬇  L H     L  H ︎
  *  H    H    ⬇  H H     Q_ Q (toggle) ︎
  *  H    H    H  X X     Q  Q_
+ *
+ * This implementation is clocked on the rising instead of the falling edge.
  */
 
 struct JKFlipFlop : public Device {
@@ -150,10 +153,12 @@ struct JKFlipFlop : public Device {
     void test_setup(Circuit &) override;
     void test_run(Circuit &) override;
 
+    Inverter *clock;
     NandGate *J_gate;
-    AndGate  *set;
     NandGate *K_gate;
-    AndGate  *clr;
+    SRLatch  *primary;
+    NandGate *set;
+    NandGate *clr;
     SRLatch  *secondary;
 };
 
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "LookupTable.h"
+
+namespace Simul {
+
+LookupTable::LookupTable(std::string const &name, std::vector<Pin *> inputs, std::vector<Pin *> outputs, std::shared_ptr<Table const> table)
+    : Device(name)
+    , inputs(std::move(inputs))
+    , outputs(std::move(outputs))
+    , table(std::move(table))
+{
+    simulate_device = [this](Device *, duration) -> void {
+        size_t ix = 0;
+        for (auto bit = 0; bit < this->inputs.size(); ++bit) {
+            if (this->inputs[bit]->new_state == PinState::High) {
+                ix |= size_t { 1 } << bit;
+            }
+        }
+        auto entry = (*this->table)[ix];
+        for (auto bit = 0; bit < this->outputs.size(); ++bit) {
+            this->outputs[bit]->new_state = ((entry >> bit) & 0x01) ? PinState::High : PinState::Low;
+        }
+    };
+}
+
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Device.h"
+
+namespace Simul {
+
+// Replaces a combinational cone: the inputs, read as bits with input 0 the
+// least significant, index the table, and bit j of the entry is the value of
+// output j. Tables are immutable and shared between identical cones.
+struct LookupTable : public Device {
+    using Table = std::vector<uint64_t>;
+
+    std::vector<Pin *>           inputs;
+    std::vector<Pin *>           outputs;
+    std::shared_ptr<Table const> table;
+
+    LookupTable(std::string const &name, std::vector<Pin *> inputs, std::vector<Pin *> outputs, std::shared_ptr<Table const> table);
+};
+
+}
@@ -6,9 +6,12 @@
 
 #pragma once
 
+#include "Checkpoint.h"
 #include "Device.h"
 #include "Graphics.h"
 #include "LogicGate.h"
+#include "MemoryImage.h"
+#include "MemoryTrace.h"
 
 namespace Simul {
 
@@ -30,17 +33,29 @@ inline char const *MemoryIC_name(MemoryIC memory_ic)
     }
 }
 
+// The contents of a Memory live in storage unless an image file is mapped
+// with load_image; bytes always points at the live contents. Checkpoints
+// take copy-on-write snapshots of the contents through pages, which is told
+// about every write so that unchanged pages are shared between snapshots.
 template<MemoryIC Type, uint8_t AddressBits, bool Writable = true>
     requires less_than<AddressBits, 17>
 struct Memory : public Device {
-    std::array<uint8_t, 1 << AddressBits> bytes {};
-    std::array<Pin *, 8>                  D {};
-    std::array<Pin *, AddressBits>        A {};
-    std::array<TriStateBuffer *, 8>       buffers;
-    std::array<Pin *, 8>                  I;
-    Pin                                  *CE_ { nullptr };
-    Pin                                  *WE_ { nullptr };
-    Pin                                  *OE_ { nullptr };
+    static constexpr size_t Size = 1 << AddressBits;
+
+    std::array<uint8_t, Size>                             storage {};
+    std::span<uint8_t, Size>                              bytes { storage };
+    std::optional<MemoryImage>                            image {};
+    mutable PageTracker                                   pages { bytes };
+    std::array<Pin *, 8>                                  D {};
+    std::array<Pin *, AddressBits>                        A {};
+    std::array<TriStateBuffer *, 8>                       buffers;
+    std::array<Pin *, 8>                                  I;
+    Pin                                                  *CE_ { nullptr };
+    Pin                                                  *WE_ { nullptr };
+    Pin                                                  *OE_ { nullptr };
+    std::optional<std::function<void(uint16_t, uint8_t)>> on_write {};
+    MemoryTrace                                          *trace { nullptr };
+    uint16_t                                              trace_region { 0 };
 
     Memory()
         : Device(MemoryIC_name(Type))
@@ -64,18 +79,130 @@ struct Memory : public Device {
                 for (auto bit = 0; bit < 8; ++bit) {
                     D[bit]->new_driving = false;
                 }
+                if (trace != nullptr) {
+                    trace->idle(trace_region);
+                }
+                return;
+            }
+            auto addr = read_word<AddressBits, uint16_t>(A);
+            if (addr.floating()) {
+                for (auto bit = 0; bit < 8; ++bit) {
+                    D[bit]->new_driving = false;
+                }
+                if (trace != nullptr) {
+                    trace->idle(trace_region);
+                }
                 return;
             }
-            uint16_t addr = get_pins<AddressBits, uint16_t>(A);
             if (WE_->off() && Writable) {
                 auto value = get_pins(D);
-                bytes[addr] = value;
+                if (on_write && bytes[addr.value] != value) {
+                    (*on_write)(addr.value, value);
+                }
+                bytes[addr.value] = value;
+                pages.touch(addr.value);
+                if (trace != nullptr) {
+                    trace->record(trace_region, addr.value, value, MemoryTrace::Access::Write);
+                }
             }
             if (OE_->off()) {
-                set_pins(I, bytes[addr]);
+                set_pins(I, bytes[addr.value]);
+                if (trace != nullptr) {
+                    trace->record(trace_region, addr.value, bytes[addr.value], MemoryTrace::Access::Read);
+                }
             }
         };
     }
+
+    // Loads an image file into the memory. Intel HEX files are parsed into
+    // the current contents, any other file is mapped as a raw binary image.
+    Lib::Error<> load_image(std::string_view path, MemoryMapping mapping)
+    {
+        if (is_intel_hex(path)) {
+            if (read_only()) {
+                return Lib::LibCError { "{} is mapped read-only", name };
+            }
+            pages.touch_all();
+            return load_intel_hex(path, bytes);
+        }
+        if (Writable && mapping == MemoryMapping::ReadOnly) {
+            return Lib::LibCError { "{} can not be mapped read-only", name };
+        }
+        auto mapped = MemoryImage::map(path, Size, mapping);
+        if (mapped.is_error()) {
+            return mapped.error();
+        }
+        image.emplace(std::move(mapped.value()));
+        bytes = std::span<uint8_t, Size> { image->data(), Size };
+        pages.rebind(bytes);
+        return {};
+    }
+
+    [[nodiscard]] bool read_only() const
+    {
+        return image && image->mapping() == MemoryMapping::ReadOnly;
+    }
+
+    void save(Checkpoint &checkpoint) const override
+    {
+        checkpoint.write_pages(pages.snapshot());
+    }
+
+    // A read-only image can not have changed since the checkpoint was taken.
+    void restore(Checkpoint &checkpoint) override
+    {
+        auto const *snapshot = checkpoint.read_pages();
+        if (snapshot != nullptr && !read_only() && !pages.restore(*snapshot)) {
+            checkpoint.failed = true;
+        }
+    }
+
+    // Writes through the pins and behind the device's back, and checks that
+    // snapshots share every page that was not written in between, and that
+    // a restore puts back exactly the contents of the snapshot.
+    void test_run(Circuit &circuit) override
+    {
+        static constexpr size_t Page = MemoryPages::PageSize;
+
+        if constexpr (Writable) {
+            write_word(A, Word<uint16_t> { 0x0123 });
+            set_pins(D, 0x5A);
+            CE_->new_state = PinState::Low;
+            WE_->new_state = PinState::Low;
+            circuit.yield();
+            WE_->new_state = PinState::High;
+            CE_->new_state = PinState::High;
+            circuit.yield();
+            assert(bytes[0x0123] == 0x5A);
+        }
+        bytes[Size - 1] = 0x11;
+        pages.touch(Size - 1);
+        auto first = pages.snapshot();
+        assert(first[Size - 1] == 0x11);
+
+        bytes[Size / 2] = 0xA5;
+        pages.touch(Size / 2);
+        auto second = pages.snapshot();
+        assert(second.fresh == 1);
+        for (auto page = 0; page < Size / Page; ++page) {
+            assert((second.pages[page] == first.pages[page]) == (page != Size / 2 / Page));
+        }
+
+        bytes[0x0123] = 0x00;
+        bytes[Size - 1] = 0x22;
+        pages.touch(0x0123);
+        pages.touch(Size - 1);
+        auto restored = pages.restore(first);
+        assert(restored);
+        for (auto addr = 0; addr < Size; ++addr) {
+            assert(bytes[addr] == first[addr]);
+        }
+        auto third = pages.snapshot();
+        assert(third.fresh == 0);
+        assert(third.pages == first.pages);
+        restored = pages.restore(MemoryPages {});
+        assert(!restored);
+    }
 };
 
 using EEPROM_28C256 = Memory<MemoryIC::EEPROM_28C256, 15, false>;
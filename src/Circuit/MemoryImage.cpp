@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <charconv>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <Lib/ScopeGuard.h>
+
+#include "MemoryImage.h"
+
+namespace Simul {
+
+using namespace Lib;
+
+MemoryImage::MemoryImage(uint8_t *data, size_t size, MemoryMapping mapping)
+    : m_data(data)
+    , m_size(size)
+    , m_mapping(mapping)
+{
+}
+
+MemoryImage::MemoryImage(MemoryImage &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_mapping(other.m_mapping)
+{
+}
+
+MemoryImage::~MemoryImage()
+{
+    if (m_data != nullptr) {
+        ::munmap(m_data, m_size);
+    }
+}
+
+MemoryImage &MemoryImage::operator=(MemoryImage &&other) noexcept
+{
+    if (this != &other) {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+        }
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_mapping = other.m_mapping;
+    }
+    return *this;
+}
+
+Result<MemoryImage> MemoryImage::map(std::string_view path, size_t size, MemoryMapping mapping)
+{
+    std::string file_name { path };
+    auto        fh = ::open(file_name.c_str(), (mapping == MemoryMapping::Shared) ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fh < 0) {
+        return LibCError {};
+    }
+    auto       closer = [fh]() { ::close(fh); };
+    ScopeGuard file_closer { closer };
+
+    struct stat sb {};
+    if (fstat(fh, &sb) < 0) {
+        return LibCError {};
+    }
+    if (S_ISDIR(sb.st_mode)) {
+        return LibCError { EISDIR };
+    }
+    auto file_size = static_cast<size_t>(sb.st_size);
+    if (file_size > size) {
+        return LibCError { "Image {} is {} bytes, the memory only has {}", path, file_size, size };
+    }
+    if (mapping == MemoryMapping::Shared && file_size < size) {
+        if (ftruncate(fh, static_cast<off_t>(size)) < 0) {
+            return LibCError {};
+        }
+        file_size = size;
+    }
+
+    // Reserve the whole device as zeroes and map the file over the start of
+    // it, so that the part past the end of a short file reads as zeroes
+    // instead of raising SIGBUS.
+    auto  prot = (mapping == MemoryMapping::ReadOnly) ? PROT_READ : PROT_READ | PROT_WRITE;
+    auto *data = ::mmap(nullptr, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return LibCError {};
+    }
+    if (file_size > 0) {
+        auto flags = MAP_FIXED | ((mapping == MemoryMapping::Shared) ? MAP_SHARED : MAP_PRIVATE);
+        if (::mmap(data, file_size, prot, flags, fh, 0) == MAP_FAILED) {
+            LibCError err {};
+            ::munmap(data, size);
+            return err;
+        }
+    }
+    return MemoryImage { static_cast<uint8_t *>(data), size, mapping };
+}
+
+bool is_intel_hex(std::string_view path)
+{
+    return path.ends_with(".hex") || path.ends_with(".ihx");
+}
+
+Error<> load_intel_hex(std::string_view path, std::span<uint8_t> bytes)
+{
+    std::ifstream in { std::string { path } };
+    if (!in) {
+        return LibCError {};
+    }
+    uint32_t             base { 0 };
+    std::string          line;
+    std::vector<uint8_t> record;
+    for (auto line_no = 1; std::getline(in, line); ++line_no) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] != ':' || line.size() < 11 || (line.size() % 2) == 0) {
+            return LibCError { "{}:{}: Malformed Intel HEX record", path, line_no };
+        }
+        record.clear();
+        uint8_t checksum { 0 };
+        for (auto ix = 1; ix < line.size(); ix += 2) {
+            uint8_t b { 0 };
+            if (auto res = std::from_chars(line.data() + ix, line.data() + ix + 2, b, 16); res.ec != std::errc {} || res.ptr != line.data() + ix + 2) {
+                return LibCError { "{}:{}: Invalid hex digits in Intel HEX record", path, line_no };
+            }
+            record.push_back(b);
+            checksum += b;
+        }
+        if (checksum != 0) {
+            return LibCError { "{}:{}: Intel HEX record checksum mismatch", path, line_no };
+        }
+        auto len = record[0];
+        if (record.size() != len + 5) {
+            return LibCError { "{}:{}: Intel HEX record length mismatch", path, line_no };
+        }
+        auto address = static_cast<uint32_t>((record[1] << 8) | record[2]);
+        auto data = std::span { record }.subspan(4, len);
+        switch (record[3]) {
+        case 0x00:
+            for (auto b : data) {
+                bytes[(base + address++) % bytes.size()] = b;
+            }
+            break;
+        case 0x01:
+            return {};
+        case 0x02:
+            if (len != 2) {
+                return LibCError { "{}:{}: Malformed extended segment address record", path, line_no };
+            }
+            base = static_cast<uint32_t>((data[0] << 8) | data[1]) << 4;
+            break;
+        case 0x04:
+            if (len != 2) {
+                return LibCError { "{}:{}: Malformed extended linear address record", path, line_no };
+            }
+            base = static_cast<uint32_t>((data[0] << 8) | data[1]) << 16;
+            break;
+        case 0x03:
+        case 0x05:
+            // Start addresses mean nothing to a memory chip.
+            break;
+        default:
+            return LibCError { "{}:{}: Unknown Intel HEX record type {:02x}", path, line_no, record[3] };
+        }
+    }
+    return {};
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <Lib/Result.h>
+
+namespace Simul {
+
+// How a file backing a Memory device is mapped. ReadOnly is for ROM images
+// and is never copied, Private maps the file copy-on-write so the device can
+// be written to without touching the file, and Shared writes every store
+// through to the file, so the contents of a RAM persist between runs.
+enum class MemoryMapping {
+    ReadOnly,
+    Private,
+    Shared,
+};
+
+// A file mapped as the contents of a Memory device. The mapping always
+// covers the whole device; a file shorter than the device reads as zeroes
+// past its end, and with MemoryMapping::Shared it is extended to the size
+// of the device.
+class MemoryImage {
+public:
+    static Lib::Result<MemoryImage> map(std::string_view path, size_t size, MemoryMapping mapping);
+
+    MemoryImage(MemoryImage const &) = delete;
+    MemoryImage(MemoryImage &&other) noexcept;
+    ~MemoryImage();
+
+    MemoryImage &operator=(MemoryImage const &) = delete;
+    MemoryImage &operator=(MemoryImage &&other) noexcept;
+
+    [[nodiscard]] uint8_t      *data() const { return m_data; }
+    [[nodiscard]] size_t        size() const { return m_size; }
+    [[nodiscard]] MemoryMapping mapping() const { return m_mapping; }
+
+private:
+    MemoryImage(uint8_t *data, size_t size, MemoryMapping mapping);
+
+    uint8_t      *m_data { nullptr };
+    size_t        m_size { 0 };
+    MemoryMapping m_mapping { MemoryMapping::ReadOnly };
+};
+
+// Loads an Intel HEX file into bytes. Data and extended segment and linear
+// address records are supported; addresses are taken modulo the size of
+// bytes, since a memory chip only sees the low address lines.
+Lib::Error<> load_intel_hex(std::string_view path, std::span<uint8_t> bytes);
+
+bool is_intel_hex(std::string_view path);
+
+}
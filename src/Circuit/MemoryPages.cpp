@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include "MemoryPages.h"
+
+namespace Simul {
+
+PageTracker::PageTracker(std::span<uint8_t> bytes)
+{
+    rebind(bytes);
+}
+
+// Points the tracker at a new block of memory. Nothing is known about its
+// contents, so the next snapshot copies all of it.
+void PageTracker::rebind(std::span<uint8_t> bytes)
+{
+    m_bytes = bytes;
+    auto pages = (bytes.size() + MemoryPages::PageSize - 1) / MemoryPages::PageSize;
+    m_base.pages.assign(pages, nullptr);
+    m_dirty.assign((pages + 63) / 64, 0);
+    touch_all();
+}
+
+void PageTracker::touch_all()
+{
+    std::ranges::fill(m_dirty, ~0ull);
+}
+
+std::span<uint8_t> PageTracker::page_bytes(size_t page) const
+{
+    auto offset = page * MemoryPages::PageSize;
+    return m_bytes.subspan(offset, std::min(MemoryPages::PageSize, m_bytes.size() - offset));
+}
+
+MemoryPages PageTracker::snapshot()
+{
+    size_t fresh { 0 };
+    for (auto page = 0; page < m_base.pages.size(); ++page) {
+        if (!dirty(page) && m_base.pages[page] != nullptr) {
+            continue;
+        }
+        auto bytes = page_bytes(page);
+        auto copy = std::make_shared<MemoryPages::Page>();
+        std::ranges::copy(bytes, copy->begin());
+        m_base.pages[page] = std::move(copy);
+        ++fresh;
+    }
+    std::ranges::fill(m_dirty, 0);
+    auto ret = m_base;
+    ret.fresh = fresh;
+    return ret;
+}
+
+// Refuses, without touching the contents, a snapshot that was not taken
+// from a memory of the same size.
+bool PageTracker::restore(MemoryPages const &snapshot)
+{
+    if (snapshot.pages.size() != m_base.pages.size()
+        || std::ranges::any_of(snapshot.pages, [](auto const &page) { return page == nullptr; })) {
+        return false;
+    }
+    for (auto page = 0; page < m_base.pages.size(); ++page) {
+        if (!dirty(page) && m_base.pages[page] == snapshot.pages[page]) {
+            continue;
+        }
+        auto bytes = page_bytes(page);
+        std::copy_n(snapshot.pages[page]->begin(), bytes.size(), bytes.begin());
+        m_base.pages[page] = snapshot.pages[page];
+    }
+    std::ranges::fill(m_dirty, 0);
+    return true;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Simul {
+
+// Contents of a memory at one point in time, in pages of PageSize bytes.
+// Pages are immutable and reference counted: snapshots taken from the same
+// memory share every page that did not change between them.
+struct MemoryPages {
+    static constexpr size_t PageSize = 256;
+    using Page = std::array<uint8_t, PageSize>;
+
+    std::vector<std::shared_ptr<Page const>> pages {};
+    size_t                                   fresh { 0 };
+
+    [[nodiscard]] uint8_t operator[](size_t address) const
+    {
+        return (*pages[address / PageSize])[address % PageSize];
+    }
+};
+
+// Keeps track of the pages of a block of memory that were written since the
+// last snapshot or restore, so that a snapshot only copies those pages and
+// shares the others with the previous snapshot, and a restore only copies
+// the pages that differ. Writes that bypass the memory device must be
+// reported with touch().
+class PageTracker {
+public:
+    explicit PageTracker(std::span<uint8_t> bytes);
+
+    void rebind(std::span<uint8_t> bytes);
+    void touch_all();
+
+    void touch(size_t address)
+    {
+        auto page = address / MemoryPages::PageSize;
+        m_dirty[page / 64] |= 1ull << (page % 64);
+    }
+
+    MemoryPages snapshot();
+    bool        restore(MemoryPages const &snapshot);
+
+private:
+    [[nodiscard]] bool               dirty(size_t page) const { return ((m_dirty[page / 64] >> (page % 64)) & 0x01) != 0; }
+    [[nodiscard]] std::span<uint8_t> page_bytes(size_t page) const;
+
+    std::span<uint8_t>    m_bytes;
+    std::vector<uint64_t> m_dirty {};
+    MemoryPages           m_base {};
+};
+
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <bit>
+#include <charconv>
+#include <print>
+
+#include "MemoryTrace.h"
+
+namespace Simul {
+
+MemoryTrace::MemoryTrace(Circuit &circuit, size_t capacity)
+    : circuit(circuit)
+    , ring(std::bit_ceil(std::max<size_t>(capacity, 1)))
+    , mask(ring.size() - 1)
+{
+}
+
+size_t MemoryTrace::watch(uint16_t first, uint16_t last, Access access, std::optional<Callback> callback)
+{
+    watchpoints.push_back({ first, last, access, std::move(callback) });
+    return watchpoints.size() - 1;
+}
+
+// Parses a watchpoint of the form <first>[-<last>][:r|w|rw], with the
+// addresses in hex.
+bool MemoryTrace::watch(std::string_view spec)
+{
+    auto address = [](std::string_view s, uint16_t &value) -> bool {
+        if (s.starts_with("0x") || s.starts_with("0X")) {
+            s.remove_prefix(2);
+        }
+        auto res = std::from_chars(s.data(), s.data() + s.size(), value, 16);
+        return !s.empty() && res.ec == std::errc {} && res.ptr == s.data() + s.size();
+    };
+
+    auto access = Access::Both;
+    if (auto colon = spec.find(':'); colon != std::string_view::npos) {
+        auto kind = spec.substr(colon + 1);
+        if (kind == "r") {
+            access = Access::Read;
+        } else if (kind == "w") {
+            access = Access::Write;
+        } else if (kind != "rw") {
+            return false;
+        }
+        spec = spec.substr(0, colon);
+    }
+    uint16_t first { 0 };
+    uint16_t last { 0 };
+    if (auto dash = spec.find('-'); dash != std::string_view::npos) {
+        if (!address(spec.substr(0, dash), first) || !address(spec.substr(dash + 1), last) || last < first) {
+            return false;
+        }
+    } else {
+        if (!address(spec, first)) {
+            return false;
+        }
+        last = first;
+    }
+    watch(first, last, access);
+    return true;
+}
+
+void MemoryTrace::check(Entry const &entry)
+{
+    for (auto &wp : watchpoints) {
+        if (entry.address < wp.first || entry.address > wp.last
+            || (static_cast<uint8_t>(wp.access) & static_cast<uint8_t>(entry.access)) == 0) {
+            continue;
+        }
+        ++wp.hits;
+        wp.last_hit = entry;
+        if (wp.callback) {
+            (*wp.callback)(entry);
+        } else {
+            circuit.paused = true;
+        }
+    }
+}
+
+std::vector<MemoryTrace::Entry> MemoryTrace::snapshot(size_t count) const
+{
+    auto end = written.load(std::memory_order_acquire);
+    auto begin = end - std::min({ count, end, static_cast<uint64_t>(ring.size()) });
+    std::vector<Entry> ret {};
+    ret.reserve(end - begin);
+    for (auto ix = begin; ix < end; ++ix) {
+        ret.push_back(ring[ix & mask]);
+    }
+
+    // Entries the writer got to while they were being copied are garbage,
+    // and so is the one it may be writing right now.
+    auto now = written.load(std::memory_order_acquire) + 1;
+    if (now > begin + ring.size()) {
+        auto stale = std::min<uint64_t>(now - ring.size() - begin, ret.size());
+        ret.erase(ret.begin(), ret.begin() + static_cast<ptrdiff_t>(stale));
+    }
+    return ret;
+}
+
+void MemoryTrace::format(std::ostream &out, Entry const &entry) const
+{
+    std::println(out, "{:>10} {} {:<8} {:04x} {:02x}",
+        entry.tick, (entry.access == Access::Write) ? 'W' : 'R', regions[entry.region].name, entry.address, entry.value);
+}
+
+void MemoryTrace::dump(std::ostream &out, size_t count) const
+{
+    auto entries = snapshot(count);
+    std::println(out, "Last {} of {} memory accesses:", entries.size(), written.load(std::memory_order_acquire));
+    for (auto const &entry : entries) {
+        format(out, entry);
+    }
+    for (auto ix = 0; ix < watchpoints.size(); ++ix) {
+        auto const &wp = watchpoints[ix];
+        std::println(out, "Watchpoint {} {:04x}-{:04x}: {} hits", ix, wp.first, wp.last, wp.hits);
+        if (wp.hits > 0) {
+            format(out, wp.last_hit);
+        }
+    }
+}
+
+}
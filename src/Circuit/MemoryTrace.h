@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Circuit.h"
+
+namespace Simul {
+
+// Log of the reads and writes of the Memory devices attached to it, and
+// watchpoints on address ranges. A memory without a trace attached pays one
+// pointer test per access.
+//
+// Accesses go into a ring buffer that is written by the simulation thread
+// only. Readers take a snapshot without locking: they copy the entries and
+// then drop the ones the writer may have overwritten while they were
+// copying. An access is logged once for as long as the same address, value
+// and direction stay on the chip's pins; a memory reports it is deselected
+// with idle(), so that the next bus cycle is logged even if it repeats the
+// last one.
+//
+// A watchpoint fires when an access falls in its address range. Watchpoints
+// without a callback pause the circuit.
+struct MemoryTrace {
+    enum class Access : uint8_t {
+        Read = 0x01,
+        Write = 0x02,
+        Both = 0x03,
+    };
+
+    struct Entry {
+        uint64_t tick { 0 };
+        uint16_t address { 0 };
+        uint8_t  value { 0 };
+        Access   access { Access::Read };
+        uint16_t region { 0 };
+    };
+
+    using Callback = std::function<void(Entry const &)>;
+
+    struct Watchpoint {
+        uint16_t                first { 0 };
+        uint16_t                last { 0 };
+        Access                  access { Access::Both };
+        std::optional<Callback> callback {};
+        uint64_t                hits { 0 };
+        Entry                   last_hit {};
+    };
+
+    // A memory device attached to the trace. Addresses are logged relative
+    // to base, so that they match the system's address map.
+    struct Region {
+        std::string name;
+        uint16_t    base { 0 };
+        uint16_t    last_address { 0 };
+        uint8_t     last_value { 0 };
+        Access      last_access { Access::Both };
+    };
+
+    Circuit                &circuit;
+    std::vector<Entry>      ring;
+    uint64_t                mask;
+    std::atomic<uint64_t>   written { 0 };
+    std::vector<Region>     regions {};
+    std::vector<Watchpoint> watchpoints {};
+
+    // The capacity is rounded up to a power of two.
+    explicit MemoryTrace(Circuit &circuit, size_t capacity = 64 * 1024);
+
+    template<typename M>
+    void attach(M *memory, std::string_view name, uint16_t base = 0)
+    {
+        memory->trace = this;
+        memory->trace_region = static_cast<uint16_t>(regions.size());
+        regions.push_back({ std::string { name }, base });
+    }
+
+    size_t watch(uint16_t first, uint16_t last, Access access = Access::Both, std::optional<Callback> callback = {});
+    bool   watch(std::string_view spec);
+
+    void record(uint16_t region, uint16_t address, uint8_t value, Access access)
+    {
+        auto &r = regions[region];
+        if (address == r.last_address && value == r.last_value && access == r.last_access) {
+            return;
+        }
+        r.last_address = address;
+        r.last_value = value;
+        r.last_access = access;
+        Entry entry { circuit.ticks, static_cast<uint16_t>(r.base + address), value, access, region };
+        auto  n = written.load(std::memory_order_relaxed);
+        ring[n & mask] = entry;
+        written.store(n + 1, std::memory_order_release);
+        if (!watchpoints.empty()) {
+            check(entry);
+        }
+    }
+
+    void idle(uint16_t region)
+    {
+        regions[region].last_access = Access::Both;
+    }
+
+    [[nodiscard]] std::vector<Entry> snapshot(size_t count) const;
+    void                             dump(std::ostream &out, size_t count) const;
+    void                             format(std::ostream &out, Entry const &entry) const;
+
+private:
+    void check(Entry const &entry);
+};
+
+}
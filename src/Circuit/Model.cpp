@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+#include "LogicGate.h"
+#include "Model.h"
+
+namespace Simul {
+
+static std::optional<Model::Op> op_of(Device *dev)
+{
+    if (dynamic_cast<Inverter *>(dev) != nullptr) {
+        return Model::Op::Not;
+    }
+    if (dynamic_cast<NandGate *>(dev) != nullptr) {
+        return Model::Op::Nand;
+    }
+    if (dynamic_cast<AndGate *>(dev) != nullptr) {
+        return Model::Op::And;
+    }
+    if (dynamic_cast<NorGate *>(dev) != nullptr) {
+        return Model::Op::Nor;
+    }
+    if (dynamic_cast<OrGate *>(dev) != nullptr) {
+        return Model::Op::Or;
+    }
+    if (dynamic_cast<XNorGate *>(dev) != nullptr) {
+        return Model::Op::XNor;
+    }
+    if (dynamic_cast<XorGate *>(dev) != nullptr) {
+        return Model::Op::Xor;
+    }
+    return {};
+}
+
+ModelInstances::ModelInstances(std::shared_ptr<Model const> model)
+    : Device("Model instances")
+    , model(std::move(model))
+{
+    simulate_device = [this](Device *, duration) -> void {
+        auto const &m = *this->model;
+        for (auto const &step : m.schedule) {
+            auto **out = bindings.data() + step.out * count;
+            for (auto inst = 0; inst < count; ++inst) {
+                auto s = bindings[m.operands[step.first] * count + inst]->new_state;
+                switch (step.op) {
+                case Model::Op::Not:
+                    out[inst]->new_state = (s != PinState::Z) ? !s : PinState::Z;
+                    continue;
+                case Model::Op::And:
+                case Model::Op::Nand:
+                    for (auto ix = 1; ix < step.count; ++ix) {
+                        s = s & bindings[m.operands[step.first + ix] * count + inst]->new_state;
+                    }
+                    break;
+                case Model::Op::Or:
+                case Model::Op::Nor:
+                    for (auto ix = 1; ix < step.count; ++ix) {
+                        s = s | bindings[m.operands[step.first + ix] * count + inst]->new_state;
+                    }
+                    break;
+                case Model::Op::Xor:
+                case Model::Op::XNor:
+                    for (auto ix = 1; ix < step.count; ++ix) {
+                        s = s ^ bindings[m.operands[step.first + ix] * count + inst]->new_state;
+                    }
+                    break;
+                }
+                if (step.op == Model::Op::Nand || step.op == Model::Op::Nor || step.op == Model::Op::XNor) {
+                    s = !s;
+                }
+                out[inst]->new_state = s;
+            }
+        }
+    };
+}
+
+void ModelInstances::add_instance(std::vector<Pin *> const &slots)
+{
+    assert(slots.size() == model->slots);
+    std::vector<Pin *> b(model->slots * (count + 1));
+    for (auto slot = 0; slot < model->slots; ++slot) {
+        for (auto inst = 0; inst < count; ++inst) {
+            b[slot * (count + 1) + inst] = bindings[slot * count + inst];
+        }
+        b[slot * (count + 1) + count] = slots[slot];
+    }
+    bindings = std::move(b);
+    ++count;
+}
+
+ModelReport compile_models(Circuit &circuit, std::vector<Device *> const &cards)
+{
+    ModelReport                   report {};
+    std::vector<ModelInstances *> shared {};
+    for (auto *card : cards) {
+        auto                                  model = std::make_shared<Model>();
+        std::vector<Pin *>                    slots {};
+        std::unordered_map<Pin *, uint32_t>   slot_of {};
+        std::vector<Device *>                 gates {};
+        auto slot = [&](Pin *pin) -> uint32_t {
+            if (auto it = slot_of.find(pin); it != slot_of.end()) {
+                return it->second;
+            }
+            slots.push_back(pin);
+            return slot_of[pin] = static_cast<uint32_t>(slots.size() - 1);
+        };
+        recurse_components(card, [&](Device *dev) {
+            if (!dev->live || !dev->simulate_device) {
+                return;
+            }
+            auto op = op_of(dev);
+            if (!op) {
+                return;
+            }
+            Model::Step step { *op, 0, static_cast<uint32_t>(model->operands.size()), static_cast<uint32_t>(dev->pins.size() - 1) };
+            for (auto ix = 0; ix < dev->pins.size() - 1; ++ix) {
+                model->operands.push_back(slot(dev->pins[ix]));
+            }
+            step.out = slot(dev->pins.back());
+            model->schedule.push_back(step);
+            gates.push_back(dev);
+        });
+        if (gates.empty()) {
+            continue;
+        }
+        model->slots = slots.size();
+
+        auto it = std::find_if(shared.begin(), shared.end(), [&model](ModelInstances *instances) {
+            return *instances->model == *model;
+        });
+        ModelInstances *instances;
+        if (it == shared.end()) {
+            instances = new ModelInstances { model };
+            shared.push_back(instances);
+            report.steps += model->schedule.size();
+        } else {
+            instances = *it;
+        }
+        instances->add_instance(slots);
+        for (auto *gate : gates) {
+            gate->simulate_device.reset();
+        }
+        report.gates += gates.size();
+        ++report.cards;
+    }
+    for (auto *instances : shared) {
+        instances->parent = &circuit;
+        circuit.components.push_back(instances);
+    }
+    report.models = shared.size();
+    return report;
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Circuit.h"
+
+namespace Simul {
+
+// The gate-level structure of a card, compiled once per card type. Every
+// gate becomes a step reading and writing slots; a slot is a gate pin,
+// numbered in order of first use. Two cards built the same way produce the
+// same model.
+struct Model {
+    enum class Op : uint8_t {
+        Not,
+        And,
+        Nand,
+        Or,
+        Nor,
+        Xor,
+        XNor,
+    };
+
+    struct Step {
+        Op       op;
+        uint32_t out;
+        uint32_t first;
+        uint32_t count;
+
+        bool operator==(Step const &) const = default;
+    };
+
+    std::vector<Step>     schedule {};
+    std::vector<uint32_t> operands {};
+    size_t                slots { 0 };
+
+    bool operator==(Model const &) const = default;
+};
+
+// All instances of one model. An instance is nothing but the binding of the
+// model's slots to the circuit pins of one card, stored slot-major so each
+// step of the schedule is evaluated for every instance in one sweep.
+struct ModelInstances : public Device {
+    std::shared_ptr<Model const> model;
+    size_t                       count { 0 };
+    std::vector<Pin *>           bindings {};
+
+    explicit ModelInstances(std::shared_ptr<Model const> model);
+    void add_instance(std::vector<Pin *> const &slots);
+};
+
+struct ModelReport {
+    size_t cards { 0 };
+    size_t models { 0 };
+    size_t steps { 0 };
+    size_t gates { 0 };
+};
+
+ModelReport compile_models(Circuit &circuit, std::vector<Device *> const &cards);
+
+}
+
+template<>
+struct std::formatter<Simul::ModelReport, char> {
+    template<class ParseContext>
+    constexpr ParseContext::iterator parse(ParseContext &ctx)
+    {
+        auto it = ctx.begin();
+        if (it == ctx.end())
+            return it;
+        if (*it != '}')
+            throw std::format_error("Invalid format args for ModelReport");
+        return it;
+    }
+
+    template<class FmtContext>
+    FmtContext::iterator format(Simul::ModelReport const &report, FmtContext &ctx) const
+    {
+        std::ostringstream out;
+        out << "compile_models: " << report.cards << " cards share " << report.models << " models with "
+            << report.steps << " steps, replacing " << report.gates << " gate closures";
+        return std::ranges::copy(std::move(out).str(), ctx.out()).out;
+    }
+};
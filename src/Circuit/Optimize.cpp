@@ -0,0 +1,636 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+#include "LogicGate.h"
+#include "LookupTable.h"
+#include "Optimize.h"
+
+namespace Simul {
+
+// Snapshot of the wiring of the circuit. A pin is transparent if all it does
+// is copy its feed: it is an input of a gate or inverter (or the output of one
+// that has been folded away), and nothing else writes or watches it. Feed
+// chains can be followed through transparent pins without changing what the
+// pins at either end see.
+struct Netlist {
+    Circuit                             &circuit;
+    std::unordered_map<Pin *, Device *> owner {};
+    std::set<Pin *>                     driven {};
+
+    explicit Netlist(Circuit &circuit)
+        : circuit(circuit)
+    {
+        recurse_components(&circuit, [this](Device *dev) {
+            for (auto *pin : dev->pins) {
+                owner[pin] = dev;
+            }
+        });
+        for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+            if (circuit.all_pins[ix].drive) {
+                driven.insert(circuit.all_pins[ix].drive);
+            }
+        }
+    }
+
+    [[nodiscard]] bool passive(Pin *pin) const
+    {
+        return !pin->on_change && !pin->on_update && !pin->on_drive && !driven.contains(pin);
+    }
+
+    [[nodiscard]] bool transparent(Pin *pin) const
+    {
+        if (pin->feed == nullptr || !passive(pin)) {
+            return false;
+        }
+        auto it = owner.find(pin);
+        if (it == owner.end()) {
+            return false;
+        }
+        if (auto *gate = dynamic_cast<LogicGate *>(it->second); gate != nullptr) {
+            return pin != gate->Y || !gate->simulate_device;
+        }
+        if (auto *inverter = dynamic_cast<Inverter *>(it->second); inverter != nullptr) {
+            return pin != inverter->Y || !inverter->simulate_device;
+        }
+        return false;
+    }
+
+    [[nodiscard]] Pin *root(Pin *pin) const
+    {
+        for (auto hops = 0; hops < circuit.pin_count && transparent(pin); ++hops) {
+            pin = pin->feed;
+        }
+        return pin;
+    }
+
+    [[nodiscard]] std::optional<PinState> constant(Pin *pin) const
+    {
+        for (auto hops = 0; hops < circuit.pin_count && pin->feed != nullptr && passive(pin); ++hops) {
+            pin = pin->feed;
+        }
+        if (pin == circuit.VCC) {
+            return PinState::High;
+        }
+        if (pin == circuit.GND) {
+            return PinState::Low;
+        }
+        return {};
+    }
+
+    [[nodiscard]] bool foldable(Device *dev, Pin *Y) const
+    {
+        return dev->simulate_device && Y->feed == nullptr && passive(Y);
+    }
+
+    void tie(Device *dev, Pin *Y, PinState state) const
+    {
+        dev->simulate_device.reset();
+        Y->feed = (state == PinState::High) ? circuit.VCC : circuit.GND;
+        Y->state = Y->new_state = state;
+    }
+};
+
+PassReport fold_constants(Circuit &circuit)
+{
+    PassReport report { "fold_constants" };
+    auto       folded { true };
+    while (folded) {
+        folded = false;
+        Netlist net { circuit };
+        recurse_components(&circuit, [&net, &report, &folded](Device *dev) {
+            if (auto *inverter = dynamic_cast<Inverter *>(dev); inverter != nullptr && net.foldable(dev, inverter->Y)) {
+                if (auto c = net.constant(inverter->A); c) {
+                    net.tie(inverter, inverter->Y, !*c);
+                    report.pins += 1;
+                    report.devices += 1;
+                    folded = true;
+                }
+                return;
+            }
+            auto *gate = dynamic_cast<LogicGate *>(dev);
+            if (gate == nullptr || !net.foldable(dev, gate->Y)) {
+                return;
+            }
+            std::optional<PinState> acc {};
+            std::vector<Pin *>      inputs {};
+            for (auto ix = 0; ix < gate->pins.size() - 1; ++ix) {
+                if (auto c = net.constant(gate->pins[ix]); c) {
+                    acc = (acc) ? gate->operate(*acc, *c) : *c;
+                } else {
+                    inputs.push_back(gate->pins[ix]);
+                }
+            }
+            if (!acc) {
+                return;
+            }
+            if (inputs.empty()) {
+                net.tie(gate, gate->Y, gate->finalize(*acc));
+            } else {
+                auto low = gate->operate(*acc, PinState::Low);
+                auto high = gate->operate(*acc, PinState::High);
+                if (low == high && gate->operate(low, PinState::Low) == low && gate->operate(low, PinState::High) == low) {
+                    net.tie(gate, gate->Y, gate->finalize(low));
+                } else if (inputs.size() == 1 && gate->finalize(low) == PinState::Low && gate->finalize(high) == PinState::High) {
+                    gate->simulate_device.reset();
+                    gate->Y->feed = inputs[0];
+                    report.pins += gate->pins.size() - 2;
+                    report.devices += 1;
+                    folded = true;
+                    return;
+                } else {
+                    return;
+                }
+            }
+            report.pins += gate->pins.size() - 1;
+            report.devices += 1;
+            folded = true;
+        });
+    }
+    return report;
+}
+
+PassReport remove_double_inversions(Circuit &circuit)
+{
+    PassReport report { "remove_double_inversions" };
+    Netlist    net { circuit };
+    recurse_components(&circuit, [&net, &report](Device *dev) {
+        auto *outer = dynamic_cast<Inverter *>(dev);
+        if (outer == nullptr || outer->A->feed == nullptr || !net.foldable(outer, outer->Y)) {
+            return;
+        }
+        auto *source = net.root(outer->A->feed);
+        auto  it = net.owner.find(source);
+        if (it == net.owner.end()) {
+            return;
+        }
+        auto *inner = dynamic_cast<Inverter *>(it->second);
+        if (inner == nullptr || inner == outer || source != inner->Y || !inner->simulate_device) {
+            return;
+        }
+        outer->simulate_device.reset();
+        outer->Y->feed = inner->A;
+        report.pins += 2;
+        report.devices += 1;
+    });
+    return report;
+}
+
+PassReport collapse_feeds(Circuit &circuit)
+{
+    PassReport      report { "collapse_feeds" };
+    Netlist         net { circuit };
+    std::set<Pin *> sources {};
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        if (auto *feed = circuit.all_pins[ix].feed; feed != nullptr) {
+            sources.insert(feed);
+        }
+    }
+    std::set<Pin *> roots {};
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        auto &pin = circuit.all_pins[ix];
+        if (pin.feed != nullptr) {
+            pin.feed = net.root(pin.feed);
+            roots.insert(pin.feed);
+        }
+    }
+    report.pins = sources.size() - roots.size();
+    return report;
+}
+
+// A pin is observed if it is one of the given pins, a probe, has a handler,
+// or if its value can reach an observed pin through a feed, a drive or a
+// device. Devices are treated as black boxes: if any pin a device's
+// simulate_device can touch is observed, all of those pins are. For leaf
+// devices that is the device's own pins; composites with their own
+// simulate_device (Memory, LS245::Channel) reach into their components, so
+// for those it is all pins in the subtree.
+PassReport eliminate_dead_logic(Circuit &circuit, std::vector<Pin *> const &observed)
+{
+    PassReport                                       report { "eliminate_dead_logic" };
+    std::vector<bool>                                marked(circuit.pin_count, false);
+    std::vector<Pin *>                               work {};
+    std::vector<std::vector<Pin *>>                  drivers(circuit.pin_count);
+    std::vector<std::vector<Device *>>               scopes(circuit.pin_count);
+    std::unordered_map<Device *, std::vector<Pin *>> scope_pins {};
+
+    auto index = [&circuit](Pin *pin) -> size_t {
+        return pin - circuit.all_pins.data();
+    };
+    auto mark = [&](Pin *pin) {
+        if (pin != nullptr && !marked[index(pin)]) {
+            marked[index(pin)] = true;
+            work.push_back(pin);
+        }
+    };
+
+    recurse_components(&circuit, [&](Device *dev) {
+        dev->live = false;
+        if (!dev->simulate_device) {
+            return;
+        }
+        auto &pins = scope_pins[dev];
+        if (dev->components.empty()) {
+            pins = dev->pins;
+        } else {
+            recurse_components(dev, [&pins](Device *d) {
+                pins.insert(pins.end(), d->pins.begin(), d->pins.end());
+            });
+        }
+        for (auto *pin : pins) {
+            scopes[index(pin)].push_back(dev);
+        }
+    });
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        auto &pin = circuit.all_pins[ix];
+        if (pin.drive != nullptr) {
+            drivers[index(pin.drive)].push_back(&pin);
+        }
+        if (pin.on_change || pin.on_update || pin.on_drive) {
+            mark(&pin);
+        }
+    }
+    mark(circuit.VCC);
+    mark(circuit.GND);
+    for (auto *pin : observed) {
+        mark(pin);
+    }
+    for (auto *pin : circuit.probes) {
+        mark(pin);
+    }
+
+    while (!work.empty()) {
+        auto *pin = work.back();
+        work.pop_back();
+        mark(pin->feed);
+        for (auto *driver : drivers[index(pin)]) {
+            mark(driver);
+        }
+        for (auto *dev : scopes[index(pin)]) {
+            if (!dev->live) {
+                dev->live = true;
+                for (auto *p : scope_pins[dev]) {
+                    mark(p);
+                }
+            }
+        }
+    }
+
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        circuit.all_pins[ix].live = marked[ix];
+        if (!marked[ix]) {
+            ++report.pins;
+        }
+    }
+    recurse_components(&circuit, [&report](Device *dev) {
+        if (!dev->live && dev->simulate_device) {
+            ++report.devices;
+        }
+        if (!dev->simulate_device) {
+            dev->live = true;
+        }
+    });
+    return report;
+}
+
+static AIG::Literal lower_gate(AIG &aig, Device *dev, std::vector<AIG::Literal> const &ins)
+{
+    auto fold = [&aig, &ins](AIG::Literal (AIG::*op)(AIG::Literal, AIG::Literal)) -> AIG::Literal {
+        auto ret = ins[0];
+        for (auto ix = 1; ix < ins.size(); ++ix) {
+            ret = (aig.*op)(ret, ins[ix]);
+        }
+        return ret;
+    };
+    if (dynamic_cast<Inverter *>(dev) != nullptr) {
+        return AIG::negate(ins[0]);
+    }
+    if (dynamic_cast<NandGate *>(dev) != nullptr) {
+        return AIG::negate(fold(&AIG::land));
+    }
+    if (dynamic_cast<AndGate *>(dev) != nullptr) {
+        return fold(&AIG::land);
+    }
+    if (dynamic_cast<NorGate *>(dev) != nullptr) {
+        return AIG::negate(fold(&AIG::lor));
+    }
+    if (dynamic_cast<OrGate *>(dev) != nullptr) {
+        return fold(&AIG::lor);
+    }
+    if (dynamic_cast<XNorGate *>(dev) != nullptr) {
+        return AIG::negate(fold(&AIG::lxor));
+    }
+    if (dynamic_cast<XorGate *>(dev) != nullptr) {
+        return fold(&AIG::lxor);
+    }
+    UNREACHABLE();
+}
+
+// The live gates and inverters of the circuit, with every gate input traced
+// back through transparent pins to the pin that actually produces the value.
+// Gates that are part of a combinational loop (the latches are built from
+// cross-coupled NANDs) are flagged as cyclic.
+struct GateGraph {
+    Netlist                           net;
+    std::vector<Device *>             gates {};
+    std::unordered_map<Pin *, size_t> outputs {};
+    std::vector<std::vector<Pin *>>   sources {};
+    std::vector<bool>                 cyclic {};
+
+    explicit GateGraph(Circuit &circuit)
+        : net(circuit)
+    {
+        recurse_components(&circuit, [this](Device *dev) {
+            if (!dev->live || !dev->simulate_device) {
+                return;
+            }
+            if (dynamic_cast<Inverter *>(dev) != nullptr || dynamic_cast<LogicGate *>(dev) != nullptr) {
+                outputs[dev->pins.back()] = gates.size();
+                gates.push_back(dev);
+            }
+        });
+        sources.resize(gates.size());
+        for (auto g = 0; g < gates.size(); ++g) {
+            for (auto ix = 0; ix < gates[g]->pins.size() - 1; ++ix) {
+                sources[g].push_back(source(gates[g]->pins[ix]));
+            }
+        }
+        find_loops();
+    }
+
+    [[nodiscard]] Pin *source(Pin *pin) const
+    {
+        for (auto hops = 0; hops < net.circuit.pin_count && !outputs.contains(pin) && net.transparent(pin); ++hops) {
+            pin = pin->feed;
+        }
+        return pin;
+    }
+
+    [[nodiscard]] std::optional<size_t> driver(Pin *pin) const
+    {
+        if (auto it = outputs.find(pin); it != outputs.end() && !cyclic[it->second]) {
+            return it->second;
+        }
+        return {};
+    }
+
+    void find_loops()
+    {
+        std::vector<int>            index(gates.size(), -1);
+        std::vector<int>            low(gates.size(), 0);
+        std::vector<bool>           on_stack(gates.size(), false);
+        std::vector<size_t>         stack {};
+        int                         counter { 0 };
+        std::function<void(size_t)> visit = [&](size_t v) -> void {
+            index[v] = low[v] = counter++;
+            stack.push_back(v);
+            on_stack[v] = true;
+            for (auto *pin : sources[v]) {
+                auto it = outputs.find(pin);
+                if (it == outputs.end()) {
+                    continue;
+                }
+                auto w = it->second;
+                if (w == v) {
+                    cyclic[v] = true;
+                } else if (index[w] < 0) {
+                    visit(w);
+                    low[v] = std::min(low[v], low[w]);
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+            }
+            if (low[v] == index[v]) {
+                std::vector<size_t> component {};
+                size_t              w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    component.push_back(w);
+                } while (w != v);
+                if (component.size() > 1) {
+                    for (auto c : component) {
+                        cyclic[c] = true;
+                    }
+                }
+            }
+        };
+        cyclic.assign(gates.size(), false);
+        for (auto g = 0; g < gates.size(); ++g) {
+            if (index[g] < 0) {
+                visit(g);
+            }
+        }
+    }
+
+    // Lowers the gates in the given set into the AIG. Inputs of those gates
+    // that are driven from outside the set become AIG inputs, shared by
+    // source pin.
+    std::unordered_map<size_t, AIG::Literal> lower(AIG &aig, std::vector<size_t> const &set) const
+    {
+        std::unordered_map<size_t, AIG::Literal> ret {};
+        std::unordered_map<Pin *, AIG::Literal>  inputs {};
+        std::set<size_t>                         members { set.begin(), set.end() };
+        std::function<AIG::Literal(size_t)>      visit = [&](size_t g) -> AIG::Literal {
+            if (auto it = ret.find(g); it != ret.end()) {
+                return it->second;
+            }
+            std::vector<AIG::Literal> ins {};
+            for (auto *pin : sources[g]) {
+                if (auto d = driver(pin); d && members.contains(*d)) {
+                    ins.push_back(visit(*d));
+                    continue;
+                }
+                auto it = inputs.find(pin);
+                if (it == inputs.end()) {
+                    it = inputs.emplace(pin, aig.add_input(pin)).first;
+                }
+                ins.push_back(it->second);
+            }
+            return ret[g] = lower_gate(aig, gates[g], ins);
+        };
+        for (auto g : set) {
+            visit(g);
+        }
+        return ret;
+    }
+};
+
+// Lowers every live gate and inverter that is not part of a combinational
+// loop into a single AIG device. Since gate inputs are traced back to their
+// source, gates reading the same signal through different pins share AIG
+// inputs and, through structural hashing, nodes. The AIG is two-valued and
+// evaluates the whole graph in one tick: Z reads as Low and the per-gate
+// propagation delay disappears.
+AIG *lower_to_aig(Circuit &circuit)
+{
+    GateGraph           graph { circuit };
+    std::vector<size_t> set {};
+    for (auto g = 0; g < graph.gates.size(); ++g) {
+        if (!graph.cyclic[g]) {
+            set.push_back(g);
+        }
+    }
+    auto *aig = circuit.add_component<AIG>();
+    auto  lits = graph.lower(*aig, set);
+    for (auto g : set) {
+        aig->add_output(graph.gates[g]->pins.back(), lits[g]);
+        graph.gates[g]->simulate_device.reset();
+        ++aig->gates;
+    }
+    return aig;
+}
+
+// Finds the largest subtrees of the device hierarchy that consist only of
+// acyclic gates and read at most max_inputs signals, and replaces each of
+// them with a LookupTable. Gate outputs that are only read inside the cone
+// are not driven by the table. Identical cones, e.g. the decoders on each of
+// the register cards, lower to identical AIGs and share one table. Cones
+// never read more than MaxConeInputs signals.
+ConeReport compile_cones(Circuit &circuit, size_t max_inputs)
+{
+    using TablePtr = std::shared_ptr<LookupTable::Table const>;
+
+    max_inputs = std::min(max_inputs, MaxConeInputs);
+
+    ConeReport                                report {};
+    GateGraph                                 graph { circuit };
+    std::unordered_map<Device *, size_t>      index {};
+    std::vector<std::vector<Pin *>>           consumers(graph.gates.size());
+    std::map<std::vector<uint32_t>, TablePtr> tables {};
+    std::vector<LookupTable *>                compiled {};
+
+    for (auto g = 0; g < graph.gates.size(); ++g) {
+        index[graph.gates[g]] = g;
+    }
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        auto &pin = circuit.all_pins[ix];
+        if (pin.feed == nullptr) {
+            continue;
+        }
+        if (auto it = graph.outputs.find(graph.source(pin.feed)); it != graph.outputs.end()) {
+            consumers[it->second].push_back(&pin);
+        }
+    }
+
+    auto compile = [&](Device *dev, std::vector<size_t> const &set) -> bool {
+        AIG  aig {};
+        auto lits = graph.lower(aig, set);
+        if (aig.inputs.size() > max_inputs) {
+            return false;
+        }
+        std::set<Pin *> internal {};
+        for (auto g : set) {
+            internal.insert(graph.gates[g]->pins.begin(), graph.gates[g]->pins.end() - 1);
+        }
+        std::vector<Pin *> outputs {};
+        for (auto g : set) {
+            auto *Y = graph.gates[g]->pins.back();
+            auto  external = consumers[g].empty() || Y->drive != nullptr;
+            for (auto *consumer : consumers[g]) {
+                external |= !internal.contains(consumer);
+            }
+            if (external) {
+                outputs.push_back(Y);
+                aig.add_output(Y, lits[g]);
+            }
+        }
+        if (outputs.empty() || outputs.size() > 64) {
+            return false;
+        }
+
+        std::vector<uint32_t> key { static_cast<uint32_t>(aig.inputs.size()) };
+        for (auto const &node : aig.nodes) {
+            key.push_back(node.a);
+            key.push_back(node.b);
+        }
+        for (auto const &[pin, lit] : aig.outputs) {
+            key.push_back(lit);
+        }
+        auto &table = tables[key];
+        if (!table) {
+            auto                  rows = size_t { 1 } << aig.inputs.size();
+            auto                  t = std::make_shared<LookupTable::Table>(rows);
+            std::vector<uint64_t> lanes(aig.inputs.size());
+            for (size_t base = 0; base < rows; base += 64) {
+                for (auto bit = 0; bit < lanes.size(); ++bit) {
+                    lanes[bit] = 0;
+                    for (auto lane = 0; lane < 64; ++lane) {
+                        lanes[bit] |= static_cast<uint64_t>(((base + lane) >> bit) & 0x01) << lane;
+                    }
+                }
+                auto words = aig.evaluate(lanes);
+                for (auto lane = 0; lane < 64 && base + lane < rows; ++lane) {
+                    uint64_t entry { 0 };
+                    for (auto out = 0; out < words.size(); ++out) {
+                        entry |= ((words[out] >> lane) & 0x01) << out;
+                    }
+                    (*t)[base + lane] = entry;
+                }
+            }
+            table = t;
+            ++report.tables;
+            report.table_bytes += rows * sizeof(uint64_t);
+        }
+
+        std::vector<Pin *> inputs {};
+        for (auto const &[pin, lit] : aig.inputs) {
+            inputs.push_back(pin);
+        }
+        for (auto g : set) {
+            graph.gates[g]->simulate_device.reset();
+        }
+        compiled.push_back(new LookupTable { dev->name, inputs, outputs, table });
+        report.gates += set.size();
+        ++report.cones;
+        return true;
+    };
+
+    std::function<void(Device *)> visit = [&](Device *dev) -> void {
+        std::vector<size_t> set {};
+        auto                combinational { true };
+        recurse_components(dev, [&](Device *d) {
+            if (!d->live || !d->simulate_device) {
+                return;
+            }
+            if (auto it = index.find(d); it != index.end() && !graph.cyclic[it->second]) {
+                set.push_back(it->second);
+            } else {
+                combinational = false;
+            }
+        });
+        if (combinational && set.size() > 1 && compile(dev, set)) {
+            return;
+        }
+        for (auto *c : dev->components) {
+            visit(c);
+        }
+    };
+    for (auto *c : circuit.components) {
+        visit(c);
+    }
+    for (auto *table : compiled) {
+        table->parent = &circuit;
+        circuit.components.push_back(table);
+    }
+    return report;
+}
+
+std::vector<PassReport> optimize(Circuit &circuit)
+{
+    std::vector<PassReport> ret {};
+    ret.push_back(fold_constants(circuit));
+    ret.push_back(remove_double_inversions(circuit));
+    ret.push_back(collapse_feeds(circuit));
+    return ret;
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "AIG.h"
+#include "Circuit.h"
+
+namespace Simul {
+
+struct PassReport {
+    std::string_view pass;
+    size_t           pins { 0 };
+    size_t           devices { 0 };
+};
+
+struct ConeReport {
+    size_t cones { 0 };
+    size_t gates { 0 };
+    size_t tables { 0 };
+    size_t table_bytes { 0 };
+};
+
+// A cone's table has an entry for every combination of its inputs.
+static constexpr size_t MaxConeInputs = 16;
+
+PassReport              fold_constants(Circuit &circuit);
+PassReport              remove_double_inversions(Circuit &circuit);
+PassReport              collapse_feeds(Circuit &circuit);
+PassReport              eliminate_dead_logic(Circuit &circuit, std::vector<Pin *> const &observed);
+AIG                    *lower_to_aig(Circuit &circuit);
+ConeReport              compile_cones(Circuit &circuit, size_t max_inputs);
+std::vector<PassReport> optimize(Circuit &circuit);
+
+}
+
+template<>
+struct std::formatter<Simul::PassReport, char> {
+    template<class ParseContext>
+    constexpr ParseContext::iterator parse(ParseContext &ctx)
+    {
+        auto it = ctx.begin();
+        if (it == ctx.end())
+            return it;
+        if (*it != '}')
+            throw std::format_error("Invalid format args for PassReport");
+        return it;
+    }
+
+    template<class FmtContext>
+    FmtContext::iterator format(Simul::PassReport const &report, FmtContext &ctx) const
+    {
+        std::ostringstream out;
+        out << report.pass << ": " << report.pins << " pins, " << report.devices << " devices eliminated";
+        return std::ranges::copy(std::move(out).str(), ctx.out()).out;
+    }
+};
+
+template<>
+struct std::formatter<Simul::ConeReport, char> {
+    template<class ParseContext>
+    constexpr ParseContext::iterator parse(ParseContext &ctx)
+    {
+        auto it = ctx.begin();
+        if (it == ctx.end())
+            return it;
+        if (*it != '}')
+            throw std::format_error("Invalid format args for ConeReport");
+        return it;
+    }
+
+    template<class FmtContext>
+    FmtContext::iterator format(Simul::ConeReport const &report, FmtContext &ctx) const
+    {
+        std::ostringstream out;
+        out << "compile_cones: " << report.gates << " gates in " << report.cones << " cones, "
+            << report.tables << " distinct tables (" << report.table_bytes << " bytes)";
+        return std::ranges::copy(std::move(out).str(), ctx.out()).out;
+    }
+};
@@ -28,6 +28,16 @@ Oscillator::Oscillator(int frequency)
     };
 }
 
+void Oscillator::save(Checkpoint &checkpoint) const
+{
+    checkpoint.write_time(last_pulse);
+}
+
+void Oscillator::restore(Checkpoint &checkpoint)
+{
+    last_pulse = checkpoint.read_time();
+}
+
 OscillatorIcon::OscillatorIcon(Vector2 pos)
     : Package<1>(pos)
 {
@@ -87,6 +97,16 @@ BurstTrigger::BurstTrigger(duration b)
     };
 }
 
+void BurstTrigger::save(Checkpoint &checkpoint) const
+{
+    checkpoint.write_time(last_pulse);
+}
+
+void BurstTrigger::restore(Checkpoint &checkpoint)
+{
+    last_pulse = checkpoint.read_time();
+}
+
 void oscillator_test(Board &board)
 {
     board.circuit.name = "Oscillator test";
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "Checkpoint.h"
 #include "Device.h"
 #include "Graphics.h"
 
@@ -21,6 +22,8 @@ struct Oscillator : public Device {
     std::optional<OscillatorCallback> on_low;
 
     explicit Oscillator(int frequency);
+    void save(Checkpoint &checkpoint) const override;
+    void restore(Checkpoint &checkpoint) override;
 };
 
 struct BurstTrigger : public Device {
@@ -30,6 +33,8 @@ struct BurstTrigger : public Device {
     Pin     *Y;
 
     explicit BurstTrigger(duration burst);
+    void save(Checkpoint &checkpoint) const override;
+    void restore(Checkpoint &checkpoint) override;
 };
 
 struct OscillatorIcon : Package<1> {
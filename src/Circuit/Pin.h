@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -42,6 +44,7 @@ struct Pin {
     Pin                   *drive { nullptr };
     bool                   new_driving { false };
     PinState               new_state { PinState::Z };
+    bool                   live { true };
 
     Pin() = default;
 
@@ -58,26 +61,58 @@ struct Pin {
     void               flip();
 };
 
-template<size_t Bits>
-void set_pins(std::array<Pin *, Bits> pins, uint8_t value)
+// A group of pins seen as one word. Bits that are floating are set in the Z
+// mask and are zero in the value. A Word is read from and written to the
+// pins; it is not stored in their place, because the pins are what every
+// gate, feed and net reads and drives one by one.
+template<typename T>
+struct Word {
+    T value { 0 };
+    T z { 0 };
+
+    [[nodiscard]] bool floating() const
+    {
+        return z != 0;
+    }
+
+    bool operator==(Word const &) const = default;
+};
+
+template<size_t Bits, typename T = uint8_t>
+Word<T> read_word(std::array<Pin *, Bits> const &pins)
 {
+    Word<T> ret {};
     for (auto ix = 0; ix < Bits; ++ix) {
-        pins[ix]->new_state = (value & 0x01) ? PinState::High : PinState::Low;
-        value >>= 1;
+        auto s = pins[ix]->new_state;
+        ret.value |= static_cast<T>(s == PinState::High) << ix;
+        ret.z |= static_cast<T>(s == PinState::Z) << ix;
     }
+    return ret;
 }
 
 template<size_t Bits, typename T = uint8_t>
-T get_pins(std::array<Pin *, Bits> pins)
+void write_word(std::array<Pin *, Bits> const &pins, Word<T> word)
 {
-    T ret { 0 };
-    for (int ix = Bits - 1; ix >= 0; --ix) {
-        if (pins[ix]->new_state == PinState::Z) {
-            return ~static_cast<T>(0);
+    for (auto ix = 0; ix < Bits; ++ix) {
+        if ((word.z >> ix) & 0x01) {
+            pins[ix]->new_state = PinState::Z;
+        } else {
+            pins[ix]->new_state = ((word.value >> ix) & 0x01) ? PinState::High : PinState::Low;
         }
-        ret = (ret << 1) | ((pins[ix]->new_state == PinState::High) ? 0x01 : 0x00);
     }
-    return ret;
+}
+
+template<size_t Bits>
+void set_pins(std::array<Pin *, Bits> pins, uint8_t value)
+{
+    write_word<Bits>(pins, Word<uint8_t> { value });
+}
+
+template<size_t Bits, typename T = uint8_t>
+T get_pins(std::array<Pin *, Bits> pins)
+{
+    auto word = read_word<Bits, T>(pins);
+    return word.floating() ? ~static_cast<T>(0) : word.value;
 }
 
 template<size_t N, size_t S1 = N, size_t S2 = N, size_t O1 = 0, size_t O2 = 0>
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <cxxabi.h>
+#include <map>
+#include <print>
+#include <typeinfo>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Profiler.h"
+
+namespace Simul {
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+Profiler::Profiler(Circuit &circuit)
+    : circuit(circuit)
+{
+}
+
+void Profiler::attach()
+{
+    order.clear();
+    recurse_components(&circuit, [this](Device *dev) {
+        order.push_back(dev);
+    });
+    samples.assign(order.size(), {});
+    circuit.profiler = this;
+}
+
+void Profiler::detach()
+{
+    if (circuit.profiler == this) {
+        circuit.profiler = nullptr;
+    }
+}
+
+void Profiler::simulate(duration d)
+{
+    for (auto ix = 0; ix < order.size(); ++ix) {
+        auto *dev = order[ix];
+        if (!dev->live || !dev->simulate_device) {
+            continue;
+        }
+        auto start = cycles();
+        (*dev->simulate_device)(dev, d);
+        samples[ix].cycles += cycles() - start;
+        ++samples[ix].evaluations;
+    }
+}
+
+std::string Profiler::type_name(Device const *device)
+{
+    auto        status = 0;
+    auto       *demangled = abi::__cxa_demangle(typeid(*device).name(), nullptr, nullptr, &status);
+    std::string ret = (status == 0) ? demangled : typeid(*device).name();
+    free(demangled);
+    if (ret.starts_with("Simul::")) {
+        ret.erase(0, 7);
+    }
+    return ret;
+}
+
+// Devices directly in the circuit are the cards and are shown by name; all
+// devices below them by type.
+static std::string frame(Circuit const &circuit, Device const *device)
+{
+    auto ret = (device->parent == &circuit) ? device->name : Profiler::type_name(device);
+    std::ranges::replace(ret, ';', ',');
+    std::ranges::replace(ret, ' ', '_');
+    return ret;
+}
+
+void Profiler::report(std::ostream &out) const
+{
+    struct Total {
+        uint64_t evaluations { 0 };
+        uint64_t cycles { 0 };
+        size_t   instances { 0 };
+    };
+    std::unordered_map<std::string, Total> types {};
+    std::unordered_map<Device *, Total>    cards {};
+    uint64_t                               total = 0;
+    for (auto ix = 0; ix < order.size(); ++ix) {
+        if (samples[ix].evaluations == 0) {
+            continue;
+        }
+        auto &type = types[type_name(order[ix])];
+        type.evaluations += samples[ix].evaluations;
+        type.cycles += samples[ix].cycles;
+        ++type.instances;
+        auto *card = order[ix];
+        while (card->parent != nullptr && card->parent != &circuit) {
+            card = card->parent;
+        }
+        auto &c = cards[card];
+        c.evaluations += samples[ix].evaluations;
+        c.cycles += samples[ix].cycles;
+        ++c.instances;
+        total += samples[ix].cycles;
+    }
+    auto print = [&out, total](std::string_view name, Total const &t) {
+        std::println(out, "{:<40} {:>8} {:>14} {:>16} {:>8.1f} {:>6.2f}%", name, t.instances, t.evaluations, t.cycles,
+            static_cast<double>(t.cycles) / static_cast<double>(std::max<uint64_t>(t.evaluations, 1)),
+            100.0 * static_cast<double>(t.cycles) / static_cast<double>(std::max<uint64_t>(total, 1)));
+    };
+    std::println(out, "{:<40} {:>8} {:>14} {:>16} {:>8} {:>7}", "Device type", "Count", "Evaluations", "Cycles", "Cyc/eval", "Share");
+    std::vector<std::pair<std::string, Total>> sorted_types { types.begin(), types.end() };
+    std::ranges::sort(sorted_types, std::greater {}, [](auto const &t) { return t.second.cycles; });
+    for (auto const &[name, t] : sorted_types) {
+        print(name, t);
+    }
+    out << "\n";
+    std::println(out, "{:<40} {:>8} {:>14} {:>16} {:>8} {:>7}", "Card", "Devices", "Evaluations", "Cycles", "Cyc/eval", "Share");
+    std::vector<std::pair<Device *, Total>> sorted_cards { cards.begin(), cards.end() };
+    std::ranges::sort(sorted_cards, std::greater {}, [](auto const &c) { return c.second.cycles; });
+    for (auto const &[card, t] : sorted_cards) {
+        print(card == &circuit ? "(circuit)" : card->name, t);
+    }
+}
+
+// One line per distinct stack, frames separated by semicolons and followed
+// by the cycles spent in the innermost frame, as flamegraph.pl expects.
+void Profiler::folded(std::ostream &out) const
+{
+    std::map<std::string, uint64_t> stacks {};
+    for (auto ix = 0; ix < order.size(); ++ix) {
+        if (samples[ix].cycles == 0) {
+            continue;
+        }
+        std::string stack {};
+        for (auto const *dev = order[ix]; dev != nullptr && dev != &circuit; dev = dev->parent) {
+            stack = stack.empty() ? frame(circuit, dev) : frame(circuit, dev) + ";" + stack;
+        }
+        stacks[stack.empty() ? "(circuit)" : stack] += samples[ix].cycles;
+    }
+    for (auto const &[stack, cycles] : stacks) {
+        std::println(out, "{} {}", stack, cycles);
+    }
+}
+
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Circuit.h"
+
+namespace Simul {
+
+// Counts evaluations and the cycles spent in every device's simulate_device.
+// Once attached, the circuit evaluates its devices through the profiler,
+// which walks them in the same order as Circuit::simulate does.
+struct Profiler {
+    struct Sample {
+        uint64_t evaluations { 0 };
+        uint64_t cycles { 0 };
+    };
+
+    Circuit              &circuit;
+    std::vector<Device *> order {};
+    std::vector<Sample>   samples {};
+
+    explicit Profiler(Circuit &circuit);
+    void attach();
+    void detach();
+    void simulate(duration d);
+    void report(std::ostream &out) const;
+    void folded(std::ostream &out) const;
+
+    static std::string type_name(Device const *device);
+};
+
+}
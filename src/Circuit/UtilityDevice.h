@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "Checkpoint.h"
 #include "Device.h"
 #include "Graphics.h"
 
@@ -42,6 +43,22 @@ struct Switch : public Device {
             }
         };
     }
+
+    void save(Checkpoint &checkpoint) const override
+    {
+        checkpoint.write<uint8_t>(last_pulse.has_value());
+        if (last_pulse) {
+            checkpoint.write_time(*last_pulse);
+        }
+    }
+
+    void restore(Checkpoint &checkpoint) override
+    {
+        last_pulse.reset();
+        if (checkpoint.read<uint8_t>()) {
+            last_pulse = checkpoint.read_time();
+        }
+    }
 };
 
 template<typename P, size_t S>
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include "Waveform.h"
+
+namespace Simul {
+
+static std::string label(Device *device)
+{
+    auto ret = device->ref.empty() ? device->name : device->ref;
+    std::ranges::replace(ret, ' ', '_');
+    return ret;
+}
+
+std::unordered_map<Pin *, std::string> pin_paths(Circuit &circuit)
+{
+    std::unordered_map<Pin *, std::string> ret {};
+    std::function<void(Device *, std::string const &)> visit = [&](Device *device, std::string const &prefix) {
+        auto path = prefix;
+        if (device != &circuit) {
+            path += label(device) + "/";
+        }
+        for (auto *pin : device->pins) {
+            ret.try_emplace(pin, path + pin->name);
+        }
+        for (auto *component : device->components) {
+            visit(component, path);
+        }
+    };
+    visit(&circuit, "");
+    return ret;
+}
+
+static std::string identifier(size_t index)
+{
+    std::string ret {};
+    do {
+        ret += static_cast<char>('!' + index % 94);
+        index /= 94;
+    } while (index > 0);
+    return ret;
+}
+
+WaveformWriter::WaveformWriter(Circuit &circuit, std::string const &file_name)
+    : circuit(circuit)
+    , out(file_name, std::ios::binary)
+{
+}
+
+size_t WaveformWriter::probe(std::string_view prefix)
+{
+    if (paths.empty()) {
+        paths = pin_paths(circuit);
+    }
+    size_t ret = 0;
+    for (auto const &[pin, path] : paths) {
+        if (path.starts_with(prefix)) {
+            probe(path, std::span<Pin *const> { &pin, 1 });
+            ++ret;
+        }
+    }
+    return ret;
+}
+
+size_t WaveformWriter::probe(Device *device)
+{
+    if (paths.empty()) {
+        paths = pin_paths(circuit);
+    }
+    size_t ret = 0;
+    recurse_components(device, [this, &ret](Device *dev) {
+        for (auto *pin : dev->pins) {
+            probe(paths[pin], std::span<Pin *const> { &pin, 1 });
+            ++ret;
+        }
+    });
+    return ret;
+}
+
+void WaveformWriter::probe(std::string const &path, std::span<Pin *const> pins)
+{
+    assert(!started && !pins.empty() && pins.size() <= 64);
+    signals.push_back({ path, identifier(signals.size()), { pins.begin(), pins.end() } });
+    circuit.probes.insert(circuit.probes.end(), pins.begin(), pins.end());
+}
+
+Word<uint64_t> WaveformWriter::read(Signal const &signal) const
+{
+    Word<uint64_t> ret {};
+    for (auto ix = 0; ix < signal.pins.size(); ++ix) {
+        auto s = signal.pins[ix]->state;
+        ret.value |= static_cast<uint64_t>(s == PinState::High) << ix;
+        ret.z |= static_cast<uint64_t>(s == PinState::Z) << ix;
+    }
+    return ret;
+}
+
+void WaveformWriter::start()
+{
+    header();
+    chunk.reserve(ChunkSize);
+    chunk.push_back({ Timestamp, { static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(circuit.now).count()) } });
+    for (auto ix = 0; ix < signals.size(); ++ix) {
+        signals[ix].last = read(signals[ix]);
+        chunk.push_back({ static_cast<uint32_t>(ix), signals[ix].last });
+    }
+    writer = std::thread { [this]() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            wakeup.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                break;
+            }
+            auto changes = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            write(changes);
+            changes.clear();
+            lock.lock();
+            spare.push_back(std::move(changes));
+        }
+        finish();
+    } };
+    started = true;
+    circuit.on_tick.push_back([this](Device *, duration d) { sample(d); });
+}
+
+void WaveformWriter::stop()
+{
+    if (!started) {
+        return;
+    }
+    {
+        std::unique_lock lock(mutex);
+        queue.push_back(std::move(chunk));
+        stopping = true;
+    }
+    wakeup.notify_one();
+    writer.join();
+    started = false;
+}
+
+void WaveformWriter::sample(duration d)
+{
+    if (!started) {
+        return;
+    }
+    auto stamped = false;
+    for (auto ix = 0; ix < signals.size(); ++ix) {
+        auto &signal = signals[ix];
+        auto  word = read(signal);
+        if (word == signal.last) {
+            continue;
+        }
+        if (!stamped) {
+            chunk.push_back({ Timestamp, { static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) } });
+            stamped = true;
+        }
+        chunk.push_back({ static_cast<uint32_t>(ix), word });
+        signal.last = word;
+    }
+    if (chunk.size() >= ChunkSize) {
+        std::vector<Change> next {};
+        {
+            std::unique_lock lock(mutex);
+            queue.push_back(std::move(chunk));
+            if (!spare.empty()) {
+                next = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        wakeup.notify_one();
+        chunk = std::move(next);
+        chunk.reserve(ChunkSize);
+    }
+}
+
+VCDWriter::VCDWriter(Circuit &circuit, std::string const &file_name)
+    : WaveformWriter(circuit, file_name)
+{
+    buffer.reserve(4 * 1024 * 1024);
+}
+
+VCDWriter::~VCDWriter()
+{
+    stop();
+}
+
+// Signal paths are split on the slashes into nested scopes. Signals are
+// sorted so every scope is opened once.
+void VCDWriter::header()
+{
+    std::vector<Signal const *> sorted {};
+    for (auto const &signal : signals) {
+        sorted.push_back(&signal);
+    }
+    std::ranges::sort(sorted, [](auto *a, auto *b) { return a->path < b->path; });
+    out << "$timescale 1ns $end\n";
+    std::vector<std::string_view> open {};
+    for (auto const *signal : sorted) {
+        std::vector<std::string_view> scopes {};
+        std::string_view              path { signal->path };
+        for (auto slash = path.find('/'); slash != std::string_view::npos; slash = path.find('/')) {
+            scopes.push_back(path.substr(0, slash));
+            path.remove_prefix(slash + 1);
+        }
+        auto common = 0;
+        while (common < open.size() && common < scopes.size() && open[common] == scopes[common]) {
+            ++common;
+        }
+        for (auto ix = open.size(); ix > common; --ix) {
+            out << "$upscope $end\n";
+        }
+        for (auto ix = common; ix < scopes.size(); ++ix) {
+            out << "$scope module " << scopes[ix] << " $end\n";
+        }
+        open = std::move(scopes);
+        out << "$var wire " << signal->pins.size() << " " << signal->id << " " << path;
+        if (signal->pins.size() > 1) {
+            out << " [" << signal->pins.size() - 1 << ":0]";
+        }
+        out << " $end\n";
+    }
+    for (auto ix = 0; ix < open.size(); ++ix) {
+        out << "$upscope $end\n";
+    }
+    out << "$enddefinitions $end\n";
+}
+
+void VCDWriter::write(std::vector<Change> const &changes)
+{
+    for (auto const &change : changes) {
+        if (change.signal == Timestamp) {
+            buffer += '#';
+            buffer += std::to_string(change.word.value);
+            buffer += '\n';
+            continue;
+        }
+        auto const &signal = signals[change.signal];
+        auto        bit = [&change](size_t ix) -> char {
+            if ((change.word.z >> ix) & 0x01) {
+                return 'z';
+            }
+            return ((change.word.value >> ix) & 0x01) ? '1' : '0';
+        };
+        if (signal.pins.size() == 1) {
+            buffer += bit(0);
+        } else {
+            buffer += 'b';
+            for (auto ix = signal.pins.size(); ix > 0; --ix) {
+                buffer += bit(ix - 1);
+            }
+            buffer += ' ';
+        }
+        buffer += signal.id;
+        buffer += '\n';
+    }
+    if (buffer.size() > 3 * 1024 * 1024) {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+}
+
+void VCDWriter::finish()
+{
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+    out.flush();
+}
+
+TraceWriter::TraceWriter(Circuit &circuit, std::string const &file_name)
+    : WaveformWriter(circuit, file_name)
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+    stop();
+}
+
+void TraceWriter::header()
+{
+    std::vector<Lib::TraceSignal> trace_signals {};
+    for (auto const &signal : signals) {
+        trace_signals.push_back({ signal.path, static_cast<uint8_t>(signal.pins.size()) });
+    }
+    encoder.emplace(out, std::move(trace_signals));
+}
+
+void TraceWriter::write(std::vector<Change> const &changes)
+{
+    for (auto const &change : changes) {
+        if (change.signal == Timestamp) {
+            time = change.word.value;
+            continue;
+        }
+        encoder->change(time, change.signal, change.word.value, change.word.z);
+    }
+}
+
+void TraceWriter::finish()
+{
+    encoder->finish();
+}
+
+}
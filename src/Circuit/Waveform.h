@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <Lib/Trace.h>
+
+#include "Circuit.h"
+
+namespace Simul {
+
+// Hierarchical name of every pin in the circuit: the refs (or names) of the
+// devices containing it and the pin name, separated by slashes.
+std::unordered_map<Pin *, std::string> pin_paths(Circuit &circuit);
+
+// Records probed signals. Signals are single pins or groups of pins dumped
+// as a vector. The simulation thread only compares the probed pins against
+// their last value and queues the changes; encoding and writing happens on
+// a background thread, in the header and write overrides of the subclasses.
+struct WaveformWriter {
+    struct Signal {
+        std::string        path;
+        std::string        id;
+        std::vector<Pin *> pins;
+        Word<uint64_t>     last;
+    };
+
+    struct Change {
+        uint32_t       signal;
+        Word<uint64_t> word;
+    };
+
+    static constexpr uint32_t Timestamp = ~0u;
+    static constexpr size_t   ChunkSize = 64 * 1024;
+
+    Circuit                               &circuit;
+    std::ofstream                          out;
+    std::unordered_map<Pin *, std::string> paths {};
+    std::vector<Signal>                    signals {};
+    std::vector<Change>                    chunk {};
+    std::deque<std::vector<Change>>        queue {};
+    std::vector<std::vector<Change>>       spare {};
+    std::mutex                             mutex {};
+    std::condition_variable                wakeup {};
+    std::thread                            writer {};
+    bool                                   stopping { false };
+    bool                                   started { false };
+
+    WaveformWriter(Circuit &circuit, std::string const &file_name);
+    virtual ~WaveformWriter() = default;
+
+    size_t probe(std::string_view prefix);
+    size_t probe(Device *device);
+    void   probe(std::string const &path, std::span<Pin *const> pins);
+    void   start();
+    void   stop();
+    void   sample(duration d);
+
+protected:
+    virtual void header() = 0;
+    virtual void write(std::vector<Change> const &changes) = 0;
+    virtual void finish() = 0;
+
+private:
+    [[nodiscard]] Word<uint64_t> read(Signal const &signal) const;
+};
+
+// Value Change Dump. Signal paths become nested scopes.
+struct VCDWriter : public WaveformWriter {
+    std::string buffer {};
+
+    VCDWriter(Circuit &circuit, std::string const &file_name);
+    ~VCDWriter() override;
+
+protected:
+    void header() override;
+    void write(std::vector<Change> const &changes) override;
+    void finish() override;
+};
+
+// Binary trace, see Lib/Trace.h.
+struct TraceWriter : public WaveformWriter {
+    std::optional<Lib::TraceEncoder> encoder {};
+    uint64_t                         time { 0 };
+
+    TraceWriter(Circuit &circuit, std::string const &file_name);
+    ~TraceWriter() override;
+
+protected:
+    void header() override;
+    void write(std::vector<Change> const &changes) override;
+    void finish() override;
+};
+
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <print>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Lib/Grammar/Grammar.h>
+#include <Lib/GrammarParser/GrammarParser.h>
+#include <Lib/Hash.h>
+#include <Lib/Options.h>
+
+namespace Lib {
+
+namespace fs = std::filesystem;
+
+static std::string char_literal(char ch)
+{
+    switch (ch) {
+    case '\'':
+        return R"('\'')";
+    case '\\':
+        return R"('\\')";
+    default:
+        if (isprint(ch)) {
+            return std::format("'{}'", ch);
+        }
+        return std::format("'\\{:03o}'", static_cast<uint8_t>(ch));
+    }
+}
+
+static std::string string_literal(std::string_view s)
+{
+    std::string ret { "\"" };
+    for (auto ch : s) {
+        switch (ch) {
+        case '"':
+        case '\\':
+            ret += '\\';
+            ret += ch;
+            break;
+        default:
+            if (isprint(ch)) {
+                ret += ch;
+            } else {
+                ret += std::format("\\{:03o}", static_cast<uint8_t>(ch));
+            }
+            break;
+        }
+    }
+    return ret + "\"";
+}
+
+// The function an action refers to. Actions can name a library, as in
+// lib:function, and the resolver ignores anything from a '(' on.
+static std::string_view function_name(std::string_view full_name)
+{
+    if (auto paren = full_name.find('('); paren != std::string_view::npos) {
+        full_name = full_name.substr(0, paren);
+    }
+    if (auto colon = full_name.find(':'); colon != std::string_view::npos) {
+        full_name = full_name.substr(colon + 1);
+    }
+    return trim(full_name);
+}
+
+static std::optional<std::string> value_literal(Value const &v)
+{
+    switch (v.type()) {
+#undef S
+#define S(T, L, Size, Signed) \
+    case T##Type:             \
+        return std::format("Lib::Value {{ static_cast<" #L ">({}) }}", v.value<L>());
+        IntegerTypes(S)
+#undef S
+    case BoolType:
+        return std::format("Lib::Value {{ {} }}", v.value<bool>());
+    case FloatType:
+        return std::format("Lib::Value {{ static_cast<f32>({}) }}", v.value<f32>());
+    case DoubleType:
+        return std::format("Lib::Value {{ static_cast<f64>({}) }}", v.value<f64>());
+    default:
+        return {};
+    }
+}
+
+static std::optional<std::string> token_kind_literal(TokenKind const &kind)
+{
+    switch (kind.tag()) {
+    case KindTag::Keyword:
+        return std::format("Lib::TokenKind {{ Lib::KindTag::Keyword, std::string_view {{ {} }} }}", string_literal(kind.keyword()));
+    case KindTag::Symbol:
+        return std::format("Lib::TokenKind {{ Lib::KindTag::Symbol, {} }}", char_literal(kind.symbol()));
+    case KindTag::String:
+        return std::format("Lib::TokenKind {{ Lib::KindTag::String, {} }}", char_literal(kind.quote()));
+    case KindTag::Number:
+        return std::format("Lib::TokenKind {{ Lib::KindTag::Number, Lib::NumberType::{} }}", to_string(kind.number_type()));
+    case KindTag::Comment:
+        return {};
+    default:
+        return std::format("Lib::TokenKind {{ Lib::KindTag::{} }}", to_string(kind.tag()));
+    }
+}
+
+struct Generator {
+    Grammar                                   &grammar;
+    std::string                                name;
+    std::string                                parser;
+    uint64_t                                   grammar_hash { 0 };
+    std::map<std::string_view, uint16_t>       rules {};
+    std::vector<TokenKind>                     terminals {};
+    std::vector<GrammarAction>                 actions {};
+    std::vector<std::pair<uint16_t, uint16_t>> productions {};
+    std::vector<std::string>                   symbols {};
+    std::vector<int16_t>                       table {};
+
+    size_t terminal(TokenKind const &kind)
+    {
+        if (auto it = std::ranges::find(terminals, kind); it != terminals.end()) {
+            return it - terminals.begin();
+        }
+        terminals.push_back(kind);
+        return terminals.size() - 1;
+    }
+
+    size_t action(GrammarAction const &a)
+    {
+        if (auto it = std::ranges::find(actions, a); it != actions.end()) {
+            return it - actions.begin();
+        }
+        actions.push_back(a);
+        return actions.size() - 1;
+    }
+
+    Error<std::string> compile()
+    {
+        if (!grammar.entry_point) {
+            return std::string { "Grammar has no entry point" };
+        }
+        for (auto const &[nt, rule] : grammar.rules) {
+            rules.emplace(nt, static_cast<uint16_t>(rules.size()));
+        }
+
+        std::vector<size_t> first_production {};
+        for (auto const &[nt, rule] : grammar.rules) {
+            first_production.push_back(productions.size());
+            for (auto const &seq : rule.sequences) {
+                auto first = symbols.size();
+                for (auto const &symbol : std::ranges::reverse_view(seq.symbols)) {
+                    switch (symbol.type()) {
+                    case SymbolType::Terminal:
+                        symbols.push_back(std::format("{{ Lib::SymbolType::Terminal, {} }}", terminal(symbol.terminal())));
+                        break;
+                    case SymbolType::NonTerminal:
+                        if (!rules.contains(symbol.non_terminal())) {
+                            return std::format("Rule for non-terminal '{}' not found", symbol.non_terminal());
+                        }
+                        symbols.push_back(std::format("{{ Lib::SymbolType::NonTerminal, {} }}", rules[symbol.non_terminal()]));
+                        break;
+                    case SymbolType::Action:
+                        symbols.push_back(std::format("{{ Lib::SymbolType::Action, {} }}", action(symbol.action())));
+                        break;
+                    default:
+                        break;
+                    }
+                }
+                productions.emplace_back(first, symbols.size() - first);
+            }
+        }
+
+        // The parse tables are keyed by the terminals of the first and follow
+        // sets, which can include terminals that appear in no production.
+        for (auto const &[nt, rule] : grammar.rules) {
+            for (auto const &[symbol, seq] : rule.parse_table) {
+                if (symbol.type() == SymbolType::Terminal) {
+                    terminal(symbol.terminal());
+                }
+            }
+        }
+        if (terminals.size() > std::numeric_limits<uint16_t>::max() || symbols.size() > std::numeric_limits<uint16_t>::max()
+            || productions.size() > std::numeric_limits<int16_t>::max()) {
+            return std::string { "Grammar too large" };
+        }
+
+        table.resize(rules.size() * terminals.size(), -1);
+        auto row { 0 };
+        for (auto const &[nt, rule] : grammar.rules) {
+            for (auto const &[symbol, seq] : rule.parse_table) {
+                if (symbol.type() == SymbolType::Terminal) {
+                    table[row * terminals.size() + terminal(symbol.terminal())] = static_cast<int16_t>(first_production[row] + seq);
+                }
+            }
+            ++row;
+        }
+        return {};
+    }
+
+    void lexer(std::ostream &out) const
+    {
+        auto const &config = grammar.lexer;
+        std::println(out, "static Lib::Config {}_lexer()", name);
+        std::println(out, "{{");
+        std::println(out, "    Lib::Config config {{}};");
+        std::println(out, "    config.Comment.on = {};", config.Comment.on);
+        std::println(out, "    config.Comment.ignore = {};", config.Comment.ignore);
+        std::println(out, "    config.Comment.hashpling = {};", config.Comment.hashpling);
+        for (auto const &marker : config.Comment.block_marker) {
+            std::println(out, "    config.Comment.block_marker.push_back({{ {}, {} }});", string_literal(marker.start), string_literal(marker.end));
+        }
+        for (auto const &marker : config.Comment.eol_marker) {
+            std::println(out, "    config.Comment.eol_marker.emplace_back({});", string_literal(marker));
+        }
+        std::println(out, "    config.Identifier.on = {};", config.Identifier.on);
+        std::println(out, "    config.Keywords.on = {};", config.Keywords.on);
+        for (auto const &kw : config.Keywords.keywords) {
+            std::println(out, "    config.Keywords.add({});", string_literal(kw));
+        }
+        std::println(out, "    config.Number.on = {};", config.Number.on);
+        std::println(out, "    config.Number.signed_numbers = {};", config.Number.signed_numbers);
+        std::println(out, "    config.Number.decimal = {};", config.Number.decimal);
+        std::println(out, "    config.Number.binary = {};", config.Number.binary);
+        std::println(out, "    config.Number.hex = {};", config.Number.hex);
+        std::println(out, "    config.QString.on = {};", config.QString.on);
+        std::println(out, "    config.QString.quotes = {};", string_literal(config.QString.quotes));
+        std::println(out, "    config.Whitespace.on = {};", config.Whitespace.on);
+        std::println(out, "    config.Whitespace.ignore_ws = {};", config.Whitespace.ignore_ws);
+        std::println(out, "    config.Whitespace.ignore_nl = {};", config.Whitespace.ignore_nl);
+        std::println(out, "    return config;");
+        std::println(out, "}}\n");
+    }
+
+    // Maps a token kind to its terminal index, or -1 if no production
+    // mentions it.
+    void classify(std::ostream &out) const
+    {
+        std::map<KindTag, std::vector<size_t>> by_tag {};
+        for (auto ix = 0; ix < terminals.size(); ++ix) {
+            by_tag[terminals[ix].tag()].push_back(ix);
+        }
+        std::println(out, "static int {}_classify(Lib::TokenKind const &kind)", name);
+        std::println(out, "{{");
+        std::println(out, "    switch (kind.tag()) {{");
+        for (auto const &[tag, indices] : by_tag) {
+            std::print(out, "    case Lib::KindTag::{}:", to_string(tag));
+            switch (tag) {
+            case KindTag::Keyword:
+                std::println(out, " {{");
+                std::println(out, "        auto kw = kind.keyword();");
+                for (auto ix : indices) {
+                    std::println(out, "        if (kw == {}) {{", string_literal(terminals[ix].keyword()));
+                    std::println(out, "            return {};", ix);
+                    std::println(out, "        }}");
+                }
+                std::println(out, "        return -1;");
+                std::println(out, "    }}");
+                break;
+            case KindTag::Symbol:
+            case KindTag::String:
+                std::println(out, "");
+                std::println(out, "        switch (kind.{}()) {{", (tag == KindTag::Symbol) ? "symbol" : "quote");
+                for (auto ix : indices) {
+                    std::println(out, "        case {}:", char_literal((tag == KindTag::Symbol) ? terminals[ix].symbol() : terminals[ix].quote()));
+                    std::println(out, "            return {};", ix);
+                }
+                std::println(out, "        default:");
+                std::println(out, "            return -1;");
+                std::println(out, "        }}");
+                break;
+            case KindTag::Number:
+                std::println(out, "");
+                std::println(out, "        switch (kind.number_type()) {{");
+                for (auto ix : indices) {
+                    std::println(out, "        case Lib::NumberType::{}:", to_string(terminals[ix].number_type()));
+                    std::println(out, "            return {};", ix);
+                }
+                std::println(out, "        default:");
+                std::println(out, "            return -1;");
+                std::println(out, "        }}");
+                break;
+            default:
+                std::println(out, "");
+                std::println(out, "        return {};", indices.front());
+                break;
+            }
+        }
+        std::println(out, "    default:");
+        std::println(out, "        return -1;");
+        std::println(out, "    }}");
+        std::println(out, "}}\n");
+    }
+
+    Error<std::string> emit(std::ostream &out, std::string_view source) const
+    {
+        auto tables = std::format("Lib::ParseTables<{}>", parser);
+
+        std::println(out, "// Generated by grammar2cpp from {}. Do not edit.", source);
+        std::println(out, "//");
+        std::println(out, "// Include after the definitions of {} and of the grammar's actions.\n", parser);
+        std::println(out, "#pragma once\n");
+        std::println(out, "#include <Lib/Grammar/TableParser.h>\n");
+
+        lexer(out);
+        classify(out);
+
+        std::println(out, "static std::string_view const {}_rules[] = {{", name);
+        for (auto const &[nt, ix] : rules) {
+            std::println(out, "    {},", string_literal(nt));
+        }
+        std::println(out, "}};\n");
+
+        std::println(out, "static Lib::TokenKind const {}_terminals[] = {{", name);
+        for (auto const &kind : terminals) {
+            auto literal = token_kind_literal(kind);
+            if (!literal) {
+                return std::format("Terminal '{}' is not supported", kind);
+            }
+            std::println(out, "    {},", *literal);
+        }
+        std::println(out, "}};\n");
+
+        if (!symbols.empty()) {
+            std::println(out, "static {}::Entry const {}_symbols[] = {{", tables, name);
+            for (auto const &symbol : symbols) {
+                std::println(out, "    {},", symbol);
+            }
+            std::println(out, "}};\n");
+        }
+
+        std::println(out, "static {}::Production const {}_productions[] = {{", tables, name);
+        for (auto const &[first, count] : productions) {
+            std::println(out, "    {{ {}, {} }},", first, count);
+        }
+        std::println(out, "}};\n");
+
+        if (!table.empty()) {
+            std::println(out, "static int16_t const {}_table[] = {{", name);
+            for (auto row = 0; row < rules.size(); ++row) {
+                std::print(out, "   ");
+                for (auto col = 0; col < terminals.size(); ++col) {
+                    std::print(out, " {:>3},", table[row * terminals.size() + col]);
+                }
+                std::println(out, "");
+            }
+            std::println(out, "}};\n");
+        }
+
+        if (!actions.empty()) {
+            std::println(out, "static {}::ActionBinding const {}_actions[] = {{", tables, name);
+            for (auto const &a : actions) {
+                auto fnc = function_name(a.full_name);
+                if (a.data.is_void()) {
+                    std::println(out, "    {{ {}, []({} *parser, Lib::Value const *) {{ {}(parser); }} }},", string_literal(a.full_name), parser, fnc);
+                } else {
+                    auto data = value_literal(a.data);
+                    if (!data) {
+                        return std::format("Data of action '{}' can not be compiled", a.full_name);
+                    }
+                    std::println(out, "    {{ {}, []({} *parser, Lib::Value const *data) {{ {}(parser, data); }}, {} }},", string_literal(a.full_name), parser, fnc, *data);
+                }
+            }
+            std::println(out, "}};\n");
+        }
+
+        std::println(out, "static {} const {}_tables {{", tables, name);
+        std::println(out, "    .lexer = {}_lexer,", name);
+        std::println(out, "    .classify = {}_classify,", name);
+        std::println(out, "    .entry_point = {},", rules.at(*grammar.entry_point));
+        std::println(out, "    .rules = {}_rules,", name);
+        std::println(out, "    .terminals = {}_terminals,", name);
+        std::println(out, "    .symbols = {},", (!symbols.empty()) ? std::format("{}_symbols", name) : "{}");
+        std::println(out, "    .productions = {}_productions,", name);
+        std::println(out, "    .table = {},", (!table.empty()) ? std::format("{}_table", name) : "{}");
+        std::println(out, "    .actions = {},", (!actions.empty()) ? std::format("{}_actions", name) : "{}");
+        std::println(out, "    .grammar_hash = 0x{:016x}ull,", grammar_hash);
+        std::println(out, "}};");
+        return {};
+    }
+};
+
+// grammar2cpp [--name=<prefix>] [--parser=<type>] <grammar> <header>
+//
+// Runs the LL(1) analysis of a grammar and writes its parse tables as C++,
+// for a TableParser<T> to run from. The tables are named after the grammar
+// file unless a prefix is given, and actions are bound to functions taking
+// a pointer to the parser type, P by default.
+int main(int argc, char **argv)
+{
+    auto arg_ix = Lib::parse_options(argc, const_cast<char const **>(argv));
+    if (arg_ix + 1 >= argc) {
+        std::println(std::cerr, "Usage: grammar2cpp [--name=<prefix>] [--parser=<type>] <grammar> <header>");
+        return 1;
+    }
+    fs::path      grammar_file { argv[arg_ix] };
+    fs::path      header_file { argv[arg_ix + 1] };
+    std::ifstream in { grammar_file };
+    if (!in) {
+        std::println(std::cerr, "Error opening {}", grammar_file.string());
+        return 1;
+    }
+    std::string source { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+
+    GrammarParser gp { source };
+    Grammar       grammar {};
+    if (auto e = gp.parse(grammar); e.is_error()) {
+        std::println(std::cerr, "{} Error parsing grammar: {}", gp.lexer.location, e.error());
+        return 1;
+    }
+
+    Generator generator {
+        .grammar = grammar,
+        .name = std::string { Lib::get_option("name").value_or(grammar_file.stem().string()) },
+        .parser = std::string { Lib::get_option("parser").value_or("P") },
+        .grammar_hash = Lib::fnv1a(source),
+    };
+    std::ostringstream out;
+    if (auto e = generator.compile(); e.is_error()) {
+        std::println(std::cerr, "{}: {}", grammar_file.string(), e.error());
+        return 1;
+    }
+    if (auto e = generator.emit(out, grammar_file.filename().string()); e.is_error()) {
+        std::println(std::cerr, "{}: {}", grammar_file.string(), e.error());
+        return 1;
+    }
+
+    if (header_file.has_parent_path()) {
+        fs::create_directories(header_file.parent_path());
+    }
+    std::ofstream header { header_file };
+    header << std::move(out).str();
+    if (!header) {
+        std::println(std::cerr, "Error writing {}", header_file.string());
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    return Lib::main(argc, argv);
+}
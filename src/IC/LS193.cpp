@@ -95,10 +95,10 @@ void LS193::test_run(Circuit &circuit)
     assert(Q[1]->off());
     assert(Q[2]->off());
     assert(Q[3]->off());
-    Load_->state = PinState::High;
+    Load_->new_state = PinState::High;
     circuit.yield();
     set_pins(D, 0x01);
-    Load_->state = PinState::Low;
+    Load_->new_state = PinState::Low;
     circuit.yield();
     assert(Q[0]->on());
     assert(Q[1]->off());
@@ -116,16 +116,16 @@ void LS193::test_run(Circuit &circuit)
     assert(Q[1]->off());
     assert(Q[2]->on());
     assert(Q[3]->off());
-    Load_->state = PinState::High;
-    Up->state = PinState::Low;
+    Load_->new_state = PinState::High;
+    Up->new_state = PinState::Low;
     circuit.yield();
-    Up->state = PinState::High;
+    Up->new_state = PinState::High;
     circuit.yield();
     assert(Q[0]->on());
     assert(Q[1]->off());
     assert(Q[2]->on());
     assert(Q[3]->off());
-    Up->state = PinState::Low;
+    Up->new_state = PinState::Low;
     circuit.yield();
 }
 
@@ -52,6 +52,13 @@ LS377::LS377()
     }
 }
 
+void LS377::load(uint8_t value)
+{
+    for (auto bit = 0; bit < 8; ++bit) {
+        latches[bit]->flipflop->load(((value >> bit) & 0x01) ? PinState::High : PinState::Low);
+    }
+}
+
 struct LatchView : public Package<4> {
     explicit LatchView(Vector2 pin1)
         : Package<4>(pin1)
@@ -39,6 +39,7 @@ struct LS377 : public Device {
     std::array<Pin *, 8>   Q {};
 
     LS377();
+    void load(uint8_t value);
 };
 
 void LS377_test(Board &);
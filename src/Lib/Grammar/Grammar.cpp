@@ -121,9 +121,44 @@ Error<GrammarError> Grammar::build_parse_table()
     for (auto &entry : rules) {
         entry.second.build_parse_table();
     }
+    if (!late_binding) {
+        bind_actions();
+    }
     return {};
 }
 
+Result<void_t, GrammarError> Grammar::resolve_action(std::string_view full_name) const
+{
+    if (auto it = actions.find(full_name); it != actions.end()) {
+        return it->second;
+    }
+    if (auto res = resolver.resolve<void()>(full_name); res.has_value()) {
+        if (auto fnc = res.value().target<void_t>(); fnc != nullptr && *fnc != nullptr) {
+            return *fnc;
+        }
+    }
+    return GrammarError::ActionUnresolved;
+}
+
+// Actions that can not be resolved are left unbound. They are looked up
+// again when they fire, and fail the parse if they still can not be found.
+void Grammar::bind_actions()
+{
+    for (auto &entry : rules) {
+        for (auto &seq : entry.second.sequences) {
+            for (auto &symbol : seq.symbols) {
+                if (symbol.type() != SymbolType::Action) {
+                    continue;
+                }
+                auto &action = symbol.action();
+                if (auto fnc = resolve_action(action.full_name); fnc.has_value()) {
+                    action.function = fnc.value();
+                }
+            }
+        }
+    }
+}
+
 void Grammar::dump_parse_table() const
 {
     for (auto &entry : rules) {
@@ -13,6 +13,7 @@
 #include <functional>
 #include <map>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <string_view>
 #include <utility>
@@ -105,9 +106,13 @@ inline std::string_view to_string(SymbolType const &v)
     }
 }
 
+// An action in a production. The function it refers to is looked up when
+// the parse table is built and kept as a raw pointer; see
+// Grammar::bind_actions().
 struct GrammarAction {
     std::string_view full_name {};
     Value            data {};
+    void_t           function { nullptr };
 
     GrammarAction() = default;
     GrammarAction(std::string_view name, Value data)
@@ -116,24 +121,16 @@ struct GrammarAction {
     {
     }
 
-    template<typename Parser, typename R = SearchingResolver>
-    Result<std::function<void(Parser *, Value const *)>, GrammarError> action(R const &resolver) const
+    template<typename Parser>
+    Error<GrammarError> call(Parser &parser) const
     {
         using RawAction = void(Parser *, Value const *);
-        using Action = std::function<RawAction>;
-        auto result = resolver.template resolve<RawAction>(full_name);
-        if (result.has_value()) {
-            return result.value();
+        auto fnc = function;
+        if (fnc == nullptr || parser.grammar.late_binding) {
+            fnc = TRY_EVAL(parser.grammar.resolve_action(full_name));
         }
-        return GrammarError::ActionUnresolved;
-    }
-
-    template<typename Parser, typename R = SearchingResolver>
-    Error<GrammarError> call(Parser &parser) const
-    {
-        auto         fnc = TRY_EVAL(action<Parser>(parser.grammar.resolver));
         Value const *d = (data.type() != VoidType) ? &data : nullptr;
-        fnc(&parser, d);
+        reinterpret_cast<RawAction *>(fnc)(&parser, d);
         return {};
     }
 
@@ -187,6 +184,11 @@ struct Symbol {
         return std::get<static_cast<size_t>(SymbolType::Action)>(symbol);
     }
 
+    [[nodiscard]] GrammarAction &action()
+    {
+        return std::get<static_cast<size_t>(SymbolType::Action)>(symbol);
+    }
+
     explicit Symbol(TokenKind const &terminal)
     {
         symbol.emplace<static_cast<size_t>(SymbolType::Terminal)>(terminal);
@@ -337,14 +339,41 @@ struct Rule {
     void                          dump_parse_table() const;
 };
 
+// An entry of a static table of actions, for grammars whose actions are
+// compiled into the program. Registered actions are found without going
+// through the dynamic linker.
+struct ActionRegistration {
+    std::string_view name;
+    void_t           function;
+
+    template<typename Parser>
+    ActionRegistration(std::string_view name, void (*fnc)(Parser *, Value const *))
+        : name(name)
+        , function(reinterpret_cast<void_t>(fnc))
+    {
+    }
+
+    template<typename Parser>
+    ActionRegistration(std::string_view name, void (*fnc)(Parser *))
+        : name(name)
+        , function(reinterpret_cast<void_t>(fnc))
+    {
+    }
+};
+
 struct Grammar {
     Config                                       lexer {};
     SearchingResolver                            resolver {};
+    std::map<std::string_view, void_t>           actions {};
     std::map<std::string_view, Rule>             rules {};
     std::optional<std::string_view>              entry_point {};
     std::map<std::string_view, std::string_view> parser_config {};
     std::optional<std::string_view>              build_func = {};
 
+    // Resolve actions every time they fire instead of once when the parse
+    // table is built, e.g. to pick up a library that was reloaded.
+    bool late_binding { false };
+
     template<typename... Args>
     inline Rule &add_rule(std::string_view nt, Args &&...symbols)
     {
@@ -356,14 +385,24 @@ struct Grammar {
         return rules.at(nt);
     }
 
-    Error<GrammarError> configure(std::string_view name, std::string_view value);
-    Error<GrammarError> build_firsts();
-    Error<GrammarError> build_follows();
-    Error<GrammarError> analyze();
-    Error<GrammarError> check_LL1();
-    Error<GrammarError> build_parse_table();
-    void                dump_parse_table() const;
-    void                dump() const;
+    // Actions must be registered before the parse table is built.
+    void register_actions(std::span<ActionRegistration const> registrations)
+    {
+        for (auto const &registration : registrations) {
+            actions[registration.name] = registration.function;
+        }
+    }
+
+    Error<GrammarError>          configure(std::string_view name, std::string_view value);
+    Error<GrammarError>          build_firsts();
+    Error<GrammarError>          build_follows();
+    Error<GrammarError>          analyze();
+    Error<GrammarError>          check_LL1();
+    Error<GrammarError>          build_parse_table();
+    Result<void_t, GrammarError> resolve_action(std::string_view full_name) const;
+    void                         bind_actions();
+    void                         dump_parse_table() const;
+    void                         dump() const;
 };
 
 }
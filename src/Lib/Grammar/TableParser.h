@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <print>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <Lib/Grammar/Parser.h>
+#include <Lib/Lexer/Lexer.h>
+#include <Lib/Lib.h>
+#include <Lib/Result.h>
+#include <Lib/ScopeGuard.h>
+#include <Lib/Type/Value.h>
+
+namespace Lib {
+
+// The parse tables of an LL(1) grammar as emitted by grammar2cpp. This is
+// everything a Grammar computes when it is built, flattened into arrays:
+// terminals, rules and actions are referred to by index, the right hand
+// sides of all productions are stored back to back, each one reversed so it
+// can be pushed onto the production stack as is, and the table has one row
+// of production indices per rule and one column per terminal. Actions are
+// bound to their functions when the tables are compiled. The grammar hash
+// identifies the grammar the tables were generated from, for callers that
+// cache the results of a parse.
+template<typename P>
+struct ParseTables {
+    using Action = void (*)(P *, Value const *);
+
+    struct Entry {
+        SymbolType type;
+        uint16_t   index;
+    };
+
+    struct Production {
+        uint16_t first;
+        uint16_t count;
+    };
+
+    struct ActionBinding {
+        std::string_view name;
+        Action           action;
+        Value            data {};
+    };
+
+    Config (*lexer)();
+    int (*classify)(TokenKind const &kind);
+    uint16_t                          entry_point;
+    std::span<std::string_view const> rules;
+    std::span<TokenKind const>        terminals;
+    std::span<Entry const>            symbols;
+    std::span<Production const>       productions;
+    std::span<int16_t const>          table;
+    std::span<ActionBinding const>    actions;
+    uint64_t                          grammar_hash { 0 };
+
+    [[nodiscard]] int production(uint16_t rule, int terminal) const
+    {
+        if (terminal < 0) {
+            return -1;
+        }
+        return table[rule * terminals.size() + terminal];
+    }
+};
+
+// Drop-in for Parser<T> that runs from generated tables instead of a
+// Grammar. Accepts and rejects exactly the same input.
+template<typename T>
+struct TableParser {
+    using Tables = ParseTables<TableParser>;
+    using Entry = Tables::Entry;
+
+    Tables const      &tables;
+    Config             config;
+    std::vector<Entry> prod_stack {};
+    Token              last_token {};
+    bool               log { false };
+    T                  impl;
+
+    explicit TableParser(Tables const &tables)
+        : tables(tables)
+        , config(tables.lexer())
+        , impl(T {})
+    {
+    }
+
+    Error<ParserError> parse(std::string_view source, std::string_view buffer = "")
+    {
+        prod_stack.clear();
+        prod_stack.push_back({ SymbolType::NonTerminal, tables.entry_point });
+        Lexer lexer { config, source, buffer };
+        impl.startup(buffer);
+        auto cleanup = [this]() {
+            impl.cleanup();
+        };
+        ScopeGuard sg { cleanup };
+        impl.log = log;
+        for (auto token = lexer.next(); token; token = lexer.next()) {
+            last_token = *token;
+            if (log) {
+                std::println("{}", *token);
+            }
+            auto terminal = tables.classify(token->kind);
+            bool consumed { false };
+            while (true) {
+                if (prod_stack.empty()) {
+                    if (token->tag() == KindTag::Eof) {
+                        return {};
+                    }
+                    std::println("Production stack underflow");
+                    return ParserError::SyntaxError;
+                }
+                auto s = prod_stack.back();
+                if (consumed && (s.type == SymbolType::NonTerminal || s.type == SymbolType::Terminal)) {
+                    break;
+                }
+                prod_stack.pop_back();
+                switch (s.type) {
+                case SymbolType::NonTerminal: {
+                    if (auto prod = tables.production(s.index, terminal); prod >= 0) {
+                        auto const &p = tables.productions[prod];
+                        auto        rhs = tables.symbols.subspan(p.first, p.count);
+                        prod_stack.insert(prod_stack.end(), rhs.begin(), rhs.end());
+                    } else if (token->tag() != KindTag::Eof) {
+                        if (log) {
+                            std::println("Token: {} rule: {}", token->kind, tables.rules[s.index]);
+                        }
+                        std::println("{} Unexpected token '{}'", last_token.location, last_token);
+                        return ParserError::SyntaxError;
+                    }
+                } break;
+                case SymbolType::Terminal: {
+                    if (s.index != terminal) {
+                        std::println("{} Expected '{}', got '{}'", last_token.location, tables.terminals[s.index], token->kind);
+                        return ParserError::SyntaxError;
+                    }
+                    consumed = true;
+                } break;
+                case SymbolType::Action: {
+                    auto const &action = tables.actions[s.index];
+                    if (log) {
+                        std::println("Executing action {}", action.name);
+                    }
+                    action.action(this, !action.data.is_void() ? &action.data : nullptr);
+                } break;
+                default:
+                    break;
+                }
+            }
+        }
+        return {};
+    }
+};
+
+}
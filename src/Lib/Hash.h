@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Lib {
+
+// 64-bit FNV-1a. Used to key cached and generated files on the text they
+// were built from, so the value must never change between builds.
+constexpr uint64_t fnv1a(std::string_view text)
+{
+    uint64_t ret { 0xcbf29ce484222325ull };
+    for (auto ch : text) {
+        ret = (ret ^ static_cast<uint8_t>(ch)) * 0x100000001b3ull;
+    }
+    return ret;
+}
+
+}
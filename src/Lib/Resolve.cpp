@@ -178,7 +178,7 @@ ResolveResult Resolver::resolve_(FunctionName const &func_name)
 {
     std::lock_guard<std::mutex> const lock(g_resolve_mutex);
     if (auto result = open(func_name.library); result.has_value()) {
-        auto lib = m_images.at(Library::platform_image(func_name.library));
+        auto &lib = m_images.at(Library::platform_image(func_name.library));
         return lib.get_function(func_name.function);
     } else {
         return result.error();
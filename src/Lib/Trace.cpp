@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <Lib/Trace.h>
+
+namespace Lib {
+
+static uint32_t read32(uint8_t const *p)
+{
+    uint32_t ret;
+    memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+static void put_length(std::vector<uint8_t> &out, size_t length)
+{
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+static void put_sequence(std::vector<uint8_t> &out, std::span<uint8_t const> literals, size_t offset, size_t match)
+{
+    auto lit = literals.size();
+    auto len = (match > 0) ? match - 4 : 0;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(lit, 15) << 4) | std::min<size_t>(len, 15)));
+    if (lit >= 15) {
+        put_length(out, lit - 15);
+    }
+    out.insert(out.end(), literals.begin(), literals.end());
+    if (match == 0) {
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (len >= 15) {
+        put_length(out, len - 15);
+    }
+}
+
+std::vector<uint8_t> compress(std::span<uint8_t const> data)
+{
+    std::vector<uint8_t> ret {};
+    std::vector<int64_t> table(1 << 14, -1);
+    size_t               anchor = 0;
+    size_t               ix = 0;
+    while (ix + 4 <= data.size()) {
+        auto word = read32(data.data() + ix);
+        auto hash = (word * 2654435761u) >> 18;
+        auto candidate = table[hash];
+        table[hash] = static_cast<int64_t>(ix);
+        if (candidate < 0 || ix - candidate > 0xFFFF || read32(data.data() + candidate) != word) {
+            ++ix;
+            continue;
+        }
+        size_t match = 4;
+        while (ix + match < data.size() && data[candidate + match] == data[ix + match]) {
+            ++match;
+        }
+        put_sequence(ret, data.subspan(anchor, ix - anchor), ix - candidate, match);
+        ix += match;
+        anchor = ix;
+    }
+    put_sequence(ret, data.subspan(anchor), 0, 0);
+    return ret;
+}
+
+std::vector<uint8_t> decompress(std::span<uint8_t const> data, size_t raw_size)
+{
+    std::vector<uint8_t> ret {};
+    ret.reserve(raw_size);
+    size_t pos = 0;
+    auto   length = [&data, &pos](size_t len) -> size_t {
+        if (len == 15) {
+            uint8_t b;
+            do {
+                b = (pos < data.size()) ? data[pos++] : 0;
+                len += b;
+            } while (b == 255);
+        }
+        return len;
+    };
+    while (pos < data.size()) {
+        auto token = data[pos++];
+        auto lit = std::min(length(token >> 4), data.size() - pos);
+        ret.insert(ret.end(), data.begin() + pos, data.begin() + pos + lit);
+        pos += lit;
+        if (pos + 2 > data.size()) {
+            break;
+        }
+        size_t offset = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        auto match = length(token & 0x0F) + 4;
+        if (offset == 0 || offset > ret.size()) {
+            break;
+        }
+        for (auto start = ret.size() - offset; match > 0; --match) {
+            ret.push_back(ret[start++]);
+        }
+    }
+    return ret;
+}
+
+template<typename T>
+static void put(std::vector<uint8_t> &out, T const &value)
+{
+    auto at = out.size();
+    out.resize(at + sizeof(T));
+    memcpy(out.data() + at, &value, sizeof(T));
+}
+
+static void put_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint64_t get_varint(std::span<uint8_t const> data, size_t &pos)
+{
+    uint64_t ret = 0;
+    for (auto shift = 0; pos < data.size() && shift < 64; shift += 7) {
+        auto b = data[pos++];
+        ret |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    return ret;
+}
+
+TraceEncoder::TraceEncoder(std::ostream &out, std::vector<TraceSignal> signals, size_t block_changes)
+    : m_out(out)
+    , m_signals(std::move(signals))
+    , m_block_changes(block_changes)
+    , m_runs(m_signals.size())
+    , m_current(m_signals.size(), Run { 0, 0, ~0ull })
+{
+    std::vector<uint8_t> header {};
+    put(header, Trace::Magic);
+    put(header, Trace::Version);
+    put(header, static_cast<uint32_t>(m_signals.size()));
+    for (auto const &signal : m_signals) {
+        put(header, signal.width);
+        put(header, static_cast<uint16_t>(signal.name.size()));
+        header.insert(header.end(), signal.name.begin(), signal.name.end());
+    }
+    m_out.write(reinterpret_cast<char const *>(header.data()), static_cast<std::streamsize>(header.size()));
+    m_offset = header.size();
+}
+
+void TraceEncoder::change(uint64_t time, uint32_t signal, uint64_t value, uint64_t z)
+{
+    if (m_changes == 0) {
+        m_first = time;
+        m_initial = m_current;
+    }
+    m_runs[signal].push_back({ time, value, z });
+    m_current[signal] = { time, value, z };
+    m_last = time;
+    if (++m_changes >= m_block_changes) {
+        flush();
+    }
+}
+
+void TraceEncoder::flush()
+{
+    if (m_changes == 0) {
+        return;
+    }
+    std::vector<uint8_t> raw {};
+    for (auto const &initial : m_initial) {
+        put_varint(raw, initial.value);
+        put_varint(raw, initial.z);
+    }
+    for (auto &runs : m_runs) {
+        put_varint(raw, runs.size());
+        auto time = m_first;
+        for (auto const &run : runs) {
+            put_varint(raw, run.time - time);
+            put_varint(raw, run.value);
+            put_varint(raw, run.z);
+            time = run.time;
+        }
+        runs.clear();
+    }
+    auto block = compress(raw);
+    m_out.write(reinterpret_cast<char const *>(block.data()), static_cast<std::streamsize>(block.size()));
+    m_index.push_back({ m_first, m_last, m_offset, static_cast<uint32_t>(block.size()), static_cast<uint32_t>(raw.size()) });
+    m_offset += block.size();
+    m_changes = 0;
+}
+
+void TraceEncoder::finish()
+{
+    flush();
+    std::vector<uint8_t> footer {};
+    for (auto const &block : m_index) {
+        put(footer, block.first);
+        put(footer, block.last);
+        put(footer, block.offset);
+        put(footer, block.size);
+        put(footer, block.raw_size);
+    }
+    put(footer, m_offset);
+    put(footer, static_cast<uint32_t>(m_index.size()));
+    put(footer, Trace::Magic);
+    m_out.write(reinterpret_cast<char const *>(footer.data()), static_cast<std::streamsize>(footer.size()));
+    m_out.flush();
+}
+
+template<typename T>
+static bool get(std::istream &in, T &value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+Result<TraceReader> TraceReader::open(std::string_view file_name)
+{
+    TraceReader   ret {};
+    std::ifstream in { std::string { file_name }, std::ios::binary };
+    if (!in) {
+        return LibCError {};
+    }
+    ret.m_file_name = file_name;
+    uint32_t magic, version, count;
+    if (!get(in, magic) || magic != Trace::Magic || !get(in, version) || version != Trace::Version || !get(in, count)) {
+        return LibCError { "'{}' is not a trace file", file_name };
+    }
+    for (auto ix = 0; ix < count; ++ix) {
+        TraceSignal signal {};
+        uint16_t    length;
+        if (!get(in, signal.width) || !get(in, length)) {
+            return LibCError { "Truncated trace header in '{}'", file_name };
+        }
+        signal.name.resize(length);
+        in.read(signal.name.data(), length);
+        ret.m_signals.push_back(std::move(signal));
+    }
+
+    uint64_t index_offset;
+    uint32_t blocks;
+    in.seekg(-static_cast<std::streamoff>(sizeof(uint64_t) + 2 * sizeof(uint32_t)), std::ios::end);
+    if (!get(in, index_offset) || !get(in, blocks) || !get(in, magic) || magic != Trace::Magic) {
+        return LibCError { "Trace '{}' has no block index", file_name };
+    }
+    in.seekg(static_cast<std::streamoff>(index_offset));
+    for (auto ix = 0; ix < blocks; ++ix) {
+        TraceBlock block {};
+        if (!get(in, block.first) || !get(in, block.last) || !get(in, block.offset) || !get(in, block.size) || !get(in, block.raw_size)) {
+            return LibCError { "Truncated block index in '{}'", file_name };
+        }
+        ret.m_blocks.push_back(block);
+    }
+    return ret;
+}
+
+Error<> TraceReader::read_block(std::ifstream &in, size_t ix, std::vector<TraceChange> &initial, std::vector<TraceChange> &changes) const
+{
+    auto const          &block = m_blocks[ix];
+    std::vector<uint8_t> compressed(block.size);
+    in.seekg(static_cast<std::streamoff>(block.offset));
+    if (!in.read(reinterpret_cast<char *>(compressed.data()), block.size)) {
+        return LibCError { "Could not read block {} of '{}'", ix, m_file_name };
+    }
+    auto raw = decompress(compressed, block.raw_size);
+    if (raw.size() != block.raw_size) {
+        return LibCError { "Corrupt block {} in '{}'", ix, m_file_name };
+    }
+    size_t pos = 0;
+    initial.clear();
+    for (auto signal = 0u; signal < m_signals.size(); ++signal) {
+        auto value = get_varint(raw, pos);
+        auto z = get_varint(raw, pos);
+        initial.push_back({ block.first, signal, value, z });
+    }
+    for (auto signal = 0u; signal < m_signals.size(); ++signal) {
+        auto runs = get_varint(raw, pos);
+        auto time = block.first;
+        for (auto run = 0; run < runs; ++run) {
+            time += get_varint(raw, pos);
+            auto value = get_varint(raw, pos);
+            auto z = get_varint(raw, pos);
+            changes.push_back({ time, signal, value, z });
+        }
+    }
+    return {};
+}
+
+Result<std::vector<TraceChange>> TraceReader::read(uint64_t from, uint64_t to) const
+{
+    std::vector<TraceChange> ret {};
+    if (m_blocks.empty()) {
+        return ret;
+    }
+    std::ifstream in { m_file_name, std::ios::binary };
+    if (!in) {
+        return LibCError {};
+    }
+    auto first = std::ranges::upper_bound(m_blocks, from, {}, &TraceBlock::first);
+    auto ix = static_cast<size_t>(std::max(first - m_blocks.begin() - 1, 0l));
+
+    std::vector<TraceChange> initial {};
+    std::vector<TraceChange> changes {};
+    TRY(read_block(in, ix, initial, changes));
+    for (auto next = ix + 1; next < m_blocks.size() && m_blocks[next].first <= to; ++next) {
+        std::vector<TraceChange> ignored {};
+        TRY(read_block(in, next, ignored, changes));
+    }
+    std::ranges::stable_sort(changes, {}, &TraceChange::time);
+
+    auto it = changes.begin();
+    for (; it != changes.end() && it->time <= from; ++it) {
+        initial[it->signal] = *it;
+    }
+    for (auto &change : initial) {
+        change.time = from;
+        ret.push_back(change);
+    }
+    for (; it != changes.end() && it->time <= to; ++it) {
+        ret.push_back(*it);
+    }
+    return ret;
+}
+
+Error<> trace_to_vcd(TraceReader &reader, uint64_t from, uint64_t to, std::ostream &out)
+{
+    auto changes = TRY_EVAL(reader.read(from, to));
+    auto ids = std::vector<std::string> {};
+    out << "$timescale 1ns $end\n$scope module trace $end\n";
+    for (auto ix = 0; ix < reader.signals().size(); ++ix) {
+        std::string id {};
+        for (auto n = ix; id.empty() || n > 0; n /= 94) {
+            id += static_cast<char>('!' + n % 94);
+        }
+        auto const &signal = reader.signals()[ix];
+        auto        name = signal.name;
+        std::ranges::replace(name, '/', '.');
+        out << "$var wire " << static_cast<int>(signal.width) << " " << id << " " << name;
+        if (signal.width > 1) {
+            out << " [" << signal.width - 1 << ":0]";
+        }
+        out << " $end\n";
+        ids.push_back(std::move(id));
+    }
+    out << "$upscope $end\n$enddefinitions $end\n";
+    std::optional<uint64_t> time {};
+    for (auto const &change : changes) {
+        if (change.time != time) {
+            out << '#' << change.time << '\n';
+            time = change.time;
+        }
+        auto width = reader.signals()[change.signal].width;
+        auto bit = [&change](size_t ix) -> char {
+            if ((change.z >> ix) & 0x01) {
+                return 'z';
+            }
+            return ((change.value >> ix) & 0x01) ? '1' : '0';
+        };
+        if (width == 1) {
+            out << bit(0);
+        } else {
+            out << 'b';
+            for (auto ix = width; ix > 0; --ix) {
+                out << bit(ix - 1);
+            }
+            out << ' ';
+        }
+        out << ids[change.signal] << '\n';
+    }
+    return {};
+}
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Lib/Result.h>
+
+namespace Lib {
+
+// LZ77 compression with LZ4 style sequences: a token byte holding the
+// literal and match lengths, the literals, and a two byte match offset.
+std::vector<uint8_t> compress(std::span<uint8_t const> data);
+std::vector<uint8_t> decompress(std::span<uint8_t const> data, size_t raw_size);
+
+// Binary waveform trace. The file is a header with the signal names and
+// widths, a sequence of compressed blocks, and an index of the blocks with
+// their time range so a window can be read without scanning the file. Every
+// block starts with the value of all signals, followed per signal by its
+// runs: the time since the signal's previous change and its new value, all
+// as varints.
+struct TraceSignal {
+    std::string name;
+    uint8_t     width;
+};
+
+struct TraceChange {
+    uint64_t time;
+    uint32_t signal;
+    uint64_t value;
+    uint64_t z;
+};
+
+struct TraceBlock {
+    uint64_t first;
+    uint64_t last;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t raw_size;
+};
+
+struct Trace {
+    static constexpr uint32_t Magic = 0x544D4953; // "SIMT"
+    static constexpr uint32_t Version = 1;
+};
+
+class TraceEncoder {
+public:
+    TraceEncoder(std::ostream &out, std::vector<TraceSignal> signals, size_t block_changes = 64 * 1024);
+
+    void change(uint64_t time, uint32_t signal, uint64_t value, uint64_t z);
+    void finish();
+
+private:
+    struct Run {
+        uint64_t time;
+        uint64_t value;
+        uint64_t z;
+    };
+
+    void flush();
+
+    std::ostream                 &m_out;
+    std::vector<TraceSignal>      m_signals;
+    size_t                        m_block_changes;
+    std::vector<std::vector<Run>> m_runs;
+    std::vector<Run>              m_current;
+    std::vector<Run>              m_initial;
+    std::vector<TraceBlock>       m_index {};
+    size_t                        m_changes { 0 };
+    uint64_t                      m_first { 0 };
+    uint64_t                      m_last { 0 };
+    uint64_t                      m_offset { 0 };
+};
+
+class TraceReader {
+public:
+    static Result<TraceReader> open(std::string_view file_name);
+
+    [[nodiscard]] std::vector<TraceSignal> const &signals() const { return m_signals; }
+    [[nodiscard]] std::vector<TraceBlock> const  &blocks() const { return m_blocks; }
+
+    // The value of every signal at time 'from', as changes stamped 'from',
+    // followed by all changes in (from, to], ordered by time.
+    [[nodiscard]] Result<std::vector<TraceChange>> read(uint64_t from, uint64_t to) const;
+
+private:
+    Error<> read_block(std::ifstream &in, size_t ix, std::vector<TraceChange> &initial, std::vector<TraceChange> &changes) const;
+
+    std::string              m_file_name {};
+    std::vector<TraceSignal> m_signals {};
+    std::vector<TraceBlock>  m_blocks {};
+};
+
+Error<> trace_to_vcd(TraceReader &reader, uint64_t from, uint64_t to, std::ostream &out);
+
+}
@@ -4,12 +4,26 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <print>
+#include <string_view>
+#include <sys/wait.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 #include <raylib.h>
 
+#include <Lib/Trace.h>
+
+#include "App/MicroCodeImage.h"
+#include "Circuit/Checkpoint.h"
 #include "Circuit/Graphics.h"
+#include "Circuit/History.h"
 #include "Circuit/Latch.h"
 #include "Circuit/Memory.h"
 #include "Circuit/Oscillator.h"
@@ -307,12 +321,389 @@ void test_board<LS193_Bit0>(Board &board)
         L);
 }
 
-void main(int argc, char **argv)
+using BoardFactory = std::function<void(Board &)>;
+
+static std::vector<std::pair<std::string_view, BoardFactory>> const boards {
+    { "LS193", test_board<LS193> },
+    { "SRLatch", test_board<SRLatch> },
+    { "DFlipFlop", test_board<DFlipFlop> },
+    { "GatedSRLatch", test_board<GatedSRLatch<1>> },
+    { "GatedSRLatch2", test_board<GatedSRLatch<2>> },
+    { "GatedSRLatch3", test_board<GatedSRLatch<3>> },
+    { "GatedSRLatch4", test_board<GatedSRLatch<4>> },
+    { "LS157", LS157_test },
+    { "LS193_Bit0", test_board<LS193_Bit0> },
+    { "LS245", LS245_test },
+    { "LS377", LS377_test },
+    { "LS377_Latch", LS377_latch_test },
+    { "LS382_decoder", LS382_decoder_test },
+    { "LS382", LS382_test },
+    { "TFlipFlop", test_board<TFlipFlop> },
+    { "SRAM", memory_test },
+    { "JKFlipFlop", test_board<JKFlipFlop> },
+};
+
+// Saves a checkpoint of a counter and a RAM to a file, changes both, and
+// restores them from the file. Every truncation of the file must be refused,
+// and corrupt files must be survived.
+static void checkpoint_file_test()
+{
+    auto &circuit = Circuit::the();
+    circuit.initialize();
+    auto *counter = circuit.add_component<LS193>();
+    auto *sram = circuit.add_component<SRAM_LY62256>();
+    counter->test_setup(circuit);
+    circuit.prepare();
+    circuit.settle();
+    counter->test_run(circuit);
+    for (auto addr = 0x1000; addr < 0x1100; ++addr) {
+        sram->bytes[addr] = static_cast<uint8_t>(addr * 7);
+        sram->pages.touch(addr);
+    }
+    std::vector<uint8_t> pins {};
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        pins.push_back(pack_pin(circuit.all_pins[ix]));
+    }
+    std::vector<uint8_t> contents { sram->bytes.begin(), sram->bytes.end() };
+    auto                 saved = save_checkpoint(circuit);
+    auto                 path = (std::filesystem::temp_directory_path() / std::format("simul-checkpoint-{}", getpid())).string();
+    auto ok = saved.save(path);
+    assert(ok);
+
+    counter->Load_->new_state = PinState::Low;
+    set_pins(counter->D, 0x0A);
+    circuit.settle();
+    std::ranges::fill(sram->bytes, 0xFF);
+    sram->pages.touch_all();
+
+    Checkpoint loaded {};
+    ok = loaded.load(path);
+    assert(ok);
+    assert(loaded.bytes == saved.bytes);
+    ok = restore_checkpoint(circuit, loaded);
+    assert(ok);
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        assert(pack_pin(circuit.all_pins[ix]) == pins[ix]);
+    }
+    assert(std::ranges::equal(sram->bytes, contents));
+
+    std::ifstream in { path, std::ios::binary };
+    std::string   file { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+    for (auto size = 0; size < file.size(); ++size) {
+        std::ofstream { path, std::ios::binary | std::ios::trunc }.write(file.data(), size);
+        Checkpoint truncated {};
+        ok = truncated.load(path);
+        assert(!ok);
+    }
+
+    // A corrupt byte anywhere may or may not be noticed, but must not crash
+    // the load or the restore.
+    for (auto ix = 0; ix < file.size(); ++ix) {
+        auto corrupt = file;
+        corrupt[ix] = static_cast<char>(~corrupt[ix]);
+        std::ofstream { path, std::ios::binary | std::ios::trunc } << corrupt;
+        if (Checkpoint damaged {}; damaged.load(path)) {
+            restore_checkpoint(circuit, damaged);
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+// Runs a clocked counter that also writes a RAM through its pins past
+// several keyframes, with a step count standing in for a microcode
+// sequencer, then seeks back to a tick between keyframes. The pins, the RAM,
+// the step count and the tick count must be what they were at that tick.
+static void history_seek_test()
+{
+    auto &circuit = Circuit::the();
+    circuit.initialize();
+    auto  *counter = circuit.add_component<LS193>();
+    auto  *sram = circuit.add_component<SRAM_LY62256>();
+    auto  *oscillator = circuit.add_component<Oscillator>(250);
+    size_t steps { 0 };
+    counter->test_setup(circuit);
+    counter->Load_->state = PinState::High;
+    counter->Up->feed = oscillator->Y;
+    sram->CE_->state = PinState::Low;
+    sram->WE_->state = PinState::Low;
+    oscillator->on_low = [sram, &steps](Oscillator *) {
+        ++steps;
+        write_word(sram->A, Word<uint16_t> { static_cast<uint16_t>((steps * 37) % SRAM_LY62256::Size) });
+        set_pins(sram->D, static_cast<uint8_t>(steps * 13));
+    };
+
+    History history { circuit, 1024 * 1024 };
+    history.keyframe_interval = 64;
+    history.track(sram);
+    history.track_value(steps);
+    circuit.history = &history;
+    circuit.prepare();
+
+    circuit.step(300);
+    auto                 mark = history.ticks;
+    auto                 mark_ticks = circuit.ticks;
+    auto                 mark_steps = steps;
+    auto                 expected = save_checkpoint(circuit);
+    std::vector<uint8_t> pins {};
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        pins.push_back(pack_pin(circuit.all_pins[ix]));
+    }
+    auto same_ram = [sram, &expected]() {
+        for (auto addr = 0; addr < SRAM_LY62256::Size; ++addr) {
+            if (sram->bytes[addr] != expected.memories[0][addr]) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    circuit.step(700);
+    assert(history.keyframes.size() > 4);
+    assert(history.keyframes.front().tick < mark && mark % history.keyframe_interval != 0);
+    assert(steps > mark_steps);
+    assert(!same_ram());
+
+    auto ok = history.seek(mark);
+    assert(ok);
+    for (auto ix = 0; ix < circuit.pin_count; ++ix) {
+        assert(pack_pin(circuit.all_pins[ix]) == pins[ix]);
+    }
+    assert(same_ram());
+    assert(steps == mark_steps);
+    assert(circuit.ticks == mark_ticks);
+    ok = history.seek(mark + 1);
+    assert(!ok);
+}
+
+// Writes the same value to the same address in two bus cycles, with the chip
+// deselected in between. Each cycle must be logged once however many ticks
+// it lasts, and must hit the watchpoint.
+static void memory_trace_test()
+{
+    auto &circuit = Circuit::the();
+    circuit.initialize();
+    auto       *sram = circuit.add_component<SRAM_LY62256>();
+    MemoryTrace trace { circuit, 64 };
+    trace.attach(sram, "RAM");
+    auto wp = trace.watch(0x0123, 0x0123, MemoryTrace::Access::Write, [](MemoryTrace::Entry const &) { });
+    sram->OE_->state = PinState::High;
+    circuit.prepare();
+    for (auto cycle = 0; cycle < 2; ++cycle) {
+        write_word(sram->A, Word<uint16_t> { 0x0123 });
+        set_pins(sram->D, 0x5A);
+        sram->CE_->new_state = PinState::Low;
+        sram->WE_->new_state = PinState::Low;
+        circuit.step(5);
+        sram->WE_->new_state = PinState::High;
+        sram->CE_->new_state = PinState::High;
+        circuit.step(5);
+    }
+    assert(trace.written == 2);
+    assert(trace.watchpoints[wp].hits == 2);
+}
+
+// Encodes a few thousand changes into a trace of several blocks. Checks
+// that compress() and decompress() round-trip, that a window starting in
+// the middle of a block reads back as the signals' values at its start
+// followed by the changes in it, and that a file with a truncated footer is
+// refused.
+static void trace_file_test()
+{
+    std::vector<uint8_t> data {};
+    for (auto ix = 0; ix < 20000; ++ix) {
+        data.push_back(static_cast<uint8_t>((ix % 1000 < 500) ? ix * 7 : ix % 3));
+    }
+    for (auto size : { 0, 1, 3, 4, 17, 300, 20000 }) {
+        auto raw = std::span<uint8_t const> { data }.first(size);
+        auto round_trip = Lib::decompress(Lib::compress(raw), raw.size());
+        assert(std::ranges::equal(round_trip, raw));
+    }
+
+    std::vector<Lib::TraceSignal> signals {};
+    for (auto ix = 0; ix < 8; ++ix) {
+        signals.push_back({ std::format("S{}", ix), static_cast<uint8_t>(ix + 1) });
+    }
+    std::vector<Lib::TraceChange> written {};
+    auto                          path = (std::filesystem::temp_directory_path() / std::format("simul-trace-{}", getpid())).string();
+    {
+        std::ofstream     out { path, std::ios::binary };
+        Lib::TraceEncoder encoder { out, signals, 500 };
+        for (auto ix = 0u; ix < 4000; ++ix) {
+            auto signal = (ix * 5) % signals.size();
+            auto mask = (1ull << signals[signal].width) - 1;
+            Lib::TraceChange change { 10ull * ix + 3, static_cast<uint32_t>(signal), (ix * 2654435761ull) & mask, (ix % 11 == 0) ? mask : 0 };
+            encoder.change(change.time, change.signal, change.value, change.z);
+            written.push_back(change);
+        }
+        encoder.finish();
+    }
+
+    auto reader = Lib::TraceReader::open(path);
+    assert(reader.has_value());
+    auto const &blocks = reader.value().blocks();
+    assert(blocks.size() == 8);
+    auto from = blocks[3].first + 1234;
+    auto to = blocks[5].first + 777;
+    assert(from < blocks[3].last && to < blocks[5].last);
+    std::vector<Lib::TraceChange> expected {};
+    for (auto ix = 0u; ix < signals.size(); ++ix) {
+        expected.push_back({ from, ix, 0, ~0ull });
+    }
+    for (auto const &change : written) {
+        if (change.time <= from) {
+            expected[change.signal] = { from, change.signal, change.value, change.z };
+        } else if (change.time <= to) {
+            expected.push_back(change);
+        }
+    }
+    auto window = reader.value().read(from, to);
+    assert(window.has_value());
+    assert(window.value().size() == expected.size());
+    for (auto ix = 0; ix < expected.size(); ++ix) {
+        auto const &a = window.value()[ix];
+        auto const &b = expected[ix];
+        assert(a.time == b.time && a.signal == b.signal && a.value == b.value && a.z == b.z);
+    }
+
+    std::ifstream in { path, std::ios::binary };
+    std::string   file { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+    auto          footer = blocks.size() * (3 * sizeof(uint64_t) + 2 * sizeof(uint32_t)) + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    for (auto cut = 1; cut <= footer; ++cut) {
+        std::ofstream { path, std::ios::binary | std::ios::trunc }.write(file.data(), static_cast<std::streamsize>(file.size() - cut));
+        auto truncated = Lib::TraceReader::open(path);
+        assert(truncated.is_error());
+    }
+    std::filesystem::remove(path);
+}
+
+// Round-trips a microcode image through serialize() and deserialize(), which
+// must refuse every truncation, and checks that load_microcode() only uses
+// a cached image built from the same source by the same compiler.
+static void microcode_image_test()
+{
+    std::vector<MicroCodeStep> steps {
+        { MicroCodeAction::SetMem, MemBlock { 0x1234, { 0x55, 0xAA, 0x01 } } },
+        { MicroCodeAction::XData, Transfer { 0x01, 0x02, 0x03 } },
+        { MicroCodeAction::XAddr, Transfer { 0x0D, 0x0E, 0x00 } },
+        { MicroCodeAction::Monitor, MonitorValue { 0x42, 0x24 } },
+    };
+    auto image = MicroCodeImage::compile(steps, 0x0123456789ABCDEFull);
+    assert(image.compiler_hash == microcode_compiler_hash());
+    auto bytes = image.serialize();
+    auto copy = MicroCodeImage::deserialize(bytes);
+    assert(copy.has_value());
+    assert(copy->source_hash == image.source_hash);
+    assert(copy->compiler_hash == image.compiler_hash);
+    assert(copy->words == image.words);
+    assert(copy->memory.size() == image.memory.size());
+    for (auto ix = 0; ix < image.memory.size(); ++ix) {
+        assert(copy->memory[ix].address == image.memory[ix].address);
+        assert(copy->memory[ix].bytes == image.memory[ix].bytes);
+    }
+    for (auto size = 0; size < bytes.size(); ++size) {
+        auto truncated = MicroCodeImage::deserialize(std::span { bytes }.first(size));
+        assert(!truncated.has_value());
+    }
+
+    auto source = std::filesystem::temp_directory_path() / std::format("simul-microcode-{}.mc", getpid());
+    auto cache = std::filesystem::path { source }.replace_extension(".mcb");
+    std::ofstream { source } << "M 0x0000 { 0x55 0xAA }\nS 0x00 0x00\nA Mon MemAddr 0\n";
+    auto compiled = load_microcode(source.string());
+    assert(compiled.has_value());
+    auto write_cache = [&cache](MicroCodeImage const &cached) {
+        auto data = cached.serialize();
+        std::ofstream { cache, std::ios::binary | std::ios::trunc }.write(reinterpret_cast<char const *>(data.data()), static_cast<std::streamsize>(data.size()));
+    };
+
+    auto forged = compiled.value();
+    forged.words = { 0xFFFF };
+    write_cache(forged);
+    auto loaded = load_microcode(source.string());
+    assert(loaded.has_value() && loaded.value().words == forged.words);
+
+    forged.compiler_hash ^= 1;
+    write_cache(forged);
+    loaded = load_microcode(source.string());
+    assert(loaded.has_value() && loaded.value().words == compiled.value().words);
+
+    std::filesystem::remove(source);
+    std::filesystem::remove(cache);
+}
+
+static std::vector<std::pair<std::string_view, std::function<void()>>> const device_tests {
+    { "SRLatch", test_device<SRLatch> },
+    { "GatedSRLatch", test_device<GatedSRLatch<1>> },
+    { "DFlipFlop", test_device<DFlipFlop> },
+    { "JKFlipFlop", test_device<JKFlipFlop> },
+    { "LS193", test_device<LS193> },
+    { "SRAM", test_device<SRAM_LY62256> },
+    { "Checkpoint", checkpoint_file_test },
+    { "History", history_seek_test },
+    { "Trace", trace_file_test },
+    { "MemoryTrace", memory_trace_test },
+    { "MicroCodeImage", microcode_image_test },
+};
+
+// Runs one test in a child process, so that a failed assertion, which
+// aborts, only fails that test and every test starts with a fresh circuit.
+static bool run_test(std::string_view kind, std::string_view name, std::function<void()> const &test)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::fflush(stdout);
+    auto pid = fork();
+    if (pid == 0) {
+        test();
+        _exit(0);
+    }
+    auto status = 0;
+    waitpid(pid, &status, 0);
+    auto ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    std::println("{} {} {} ({:.2f} ms)", ok ? "PASS" : "FAIL", kind, name,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return ok;
+}
+
+// Runs every test_setup/test_run pair, and every board for a fixed number of
+// ticks, synchronously and without a window.
+static int run_tests()
+{
+    auto failures = 0;
+    for (auto const &[name, test] : device_tests) {
+        failures += !run_test("device", name, test);
+    }
+    for (auto const &[name, factory] : boards) {
+        failures += !run_test("board", name, [&factory]() {
+            auto &circuit = Circuit::the();
+            circuit.initialize();
+            Board board { circuit, Font {} };
+            factory(board);
+            circuit.prepare();
+            circuit.step(1000);
+        });
+    }
+    std::println("{} of {} tests failed", failures, device_tests.size() + boards.size());
+    return (failures > 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
 {
     std::string device { "TFlipFlop" };
     if (argc > 1) {
         device = argv[1];
     }
+    if (device == "--test") {
+        return run_tests();
+    }
+    if (device == "GatedSRLatch" && argc > 2) {
+        auto gates = strtoul(argv[2], nullptr, 10);
+        if (gates > 1 && gates <= 4) {
+            device += argv[2];
+        }
+    }
+    auto factory = std::ranges::find_if(boards, [&device](auto const &b) { return b.first == device; });
+    if (factory == boards.end()) {
+        factory = std::ranges::find_if(boards, [](auto const &b) { return b.first == "JKFlipFlop"; });
+    }
     InitWindow(30 * static_cast<int>(PITCH), 30 * static_cast<int>(PITCH), "Simul");
     {
         SetWindowState(FLAG_VSYNC_HINT);
@@ -321,55 +712,7 @@ void main(int argc, char **argv)
         {
             auto &circuit = Circuit::the();
             Board board { circuit, font };
-            if (device == "LS193") {
-                test_board<LS193>(board);
-            } else if (device == "SRLatch") {
-                test_board<SRLatch>(board);
-            } else if (device == "DFlipFlop") {
-                test_board<DFlipFlop>(board);
-            } else if (device == "GatedSRLatch") {
-                size_t gates = 1;
-                if (argc > 2) {
-                    gates = strtoul(argv[2], nullptr, 10);
-                    if (gates == 0 || gates > 4) {
-                        gates = 1;
-                    }
-                }
-                switch (gates) {
-                case 2:
-                    test_board<GatedSRLatch<2>>(board);
-                    break;
-                case 3:
-                    test_board<GatedSRLatch<3>>(board);
-                    break;
-                case 4:
-                    test_board<GatedSRLatch<4>>(board);
-                    break;
-                default:
-                    test_board<GatedSRLatch<1>>(board);
-                    break;
-                }
-            } else if (device == "LS157") {
-                LS157_test(board);
-            } else if (device == "LS193_Bit0") {
-                test_board<LS193_Bit0>(board);
-            } else if (device == "LS245") {
-                LS245_test(board);
-            } else if (device == "LS377") {
-                LS377_test(board);
-            } else if (device == "LS377_Latch") {
-                LS377_latch_test(board);
-            } else if (device == "LS382_decoder") {
-                LS382_decoder_test(board);
-            } else if (device == "LS382") {
-                LS382_test(board);
-            } else if (device == "TFlipFlop") {
-                test_board<TFlipFlop>(board);
-            } else if (device == "SRAM") {
-                memory_test(board);
-            } else {
-                test_board<JKFlipFlop>(board);
-            }
+            factory->second(board);
             board.layout(0, 0, board.size.x, board.size.y);
             SetWindowSize(static_cast<int>(board.size.x), static_cast<int>(board.size.y));
             auto t = circuit.start_simulation();
@@ -385,12 +728,11 @@ void main(int argc, char **argv)
         UnloadFont(font);
     }
     CloseWindow();
+    return 0;
 }
-
 }
 
 int main(int argc, char **argv)
 {
-    Simul::main(argc, argv);
-    return 0;
+    return Simul::main(argc, argv);
 }
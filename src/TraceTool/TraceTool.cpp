@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <print>
+
+#include <Lib/Options.h>
+#include <Lib/Trace.h>
+
+namespace Simul {
+
+static uint64_t time_option(std::string_view option, uint64_t dflt)
+{
+    if (auto value = Lib::get_option(option); value) {
+        std::from_chars(value->data(), value->data() + value->size(), dflt);
+    }
+    return dflt;
+}
+
+// trace2vcd [--from=<ns>] [--to=<ns>] <trace> [<vcd>]
+//
+// Converts the given window of a binary trace to VCD. Without an output file
+// the block index is listed.
+int main(int argc, char **argv)
+{
+    auto arg_ix = Lib::parse_options(argc, const_cast<char const **>(argv));
+    if (arg_ix >= argc) {
+        std::println(std::cerr, "Usage: trace2vcd [--from=<ns>] [--to=<ns>] <trace> [<vcd>]");
+        return 1;
+    }
+    auto reader = Lib::TraceReader::open(argv[arg_ix]);
+    if (reader.is_error()) {
+        std::println(std::cerr, "{}", reader.error().to_string());
+        return 1;
+    }
+    if (arg_ix + 1 >= argc) {
+        std::println("{} signals, {} blocks", reader->signals().size(), reader->blocks().size());
+        for (auto const &block : reader->blocks()) {
+            std::println("{:>12} - {:>12}  {:>8} bytes ({} raw) at {}", block.first, block.last, block.size, block.raw_size, block.offset);
+        }
+        return 0;
+    }
+    std::ofstream out { argv[arg_ix + 1] };
+    if (auto err = Lib::trace_to_vcd(*reader, time_option("from", 0), time_option("to", std::numeric_limits<uint64_t>::max()), out); err.is_error()) {
+        std::println(std::cerr, "{}", err.error().to_string());
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    return Simul::main(argc, argv);
+}
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <print>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <Lib/Options.h>
+
+#include "App/ALU.h"
+#include "App/ControlBus.h"
+#include "App/System.h"
+#include "Circuit/Circuit.h"
+#include "Circuit/Optimize.h"
+
+namespace Simul {
+
+// Exhaustive verification of the ALU card. Every combination of operation,
+// carry flag, LHS and RHS is driven through the card and the result and the
+// carry and overflow flags are compared with a reference model.
+//
+// A vector is a 21 bit index: RHS in bits 0-7, LHS in bits 8-15, the carry
+// flag in bit 16 and the operation in bits 17-20. The aig engine lowers the
+// card's gates to an AIG and evaluates 64 consecutive vectors per pass, one
+// per bit of the node values, spread over a number of threads. The event
+// engine runs the event driven simulation for a fixed number of ticks for
+// every vector, or every stride'th vector. The free running oscillator
+// keeps the System from ever settling, so the number of ticks has to cover
+// the longest path through the card. It is slow, but does not depend on the
+// lowering.
+//
+// The result is taken at the inputs of the result latch: the adder outputs
+// for the arithmetic and logic operations and the shifter outputs for the
+// shift operations. The flags are taken at the inputs of the flags latch.
+// The Z flag is not checked; it is computed from the result latch inputs,
+// which are not driven on this card.
+
+static constexpr size_t   VectorBits = 21;
+static constexpr uint32_t Vectors = 1u << VectorBits;
+static constexpr uint32_t VectorsPerOp = Vectors / 16;
+static constexpr uint32_t Lanes = 64;
+
+static char const *mnemonics[16] = {
+    "CLR", "RHS-LHS", "LHS-RHS", "LHS+RHS", "XOR", "OR", "AND", "0xFF",
+    "CLR", "SBB RHS-LHS", "SBB LHS-RHS", "ADC", "SHL", "SHL C", "SHR", "SHR C"
+};
+
+struct Outcome {
+    uint8_t result { 0 };
+    bool    carry { false };
+    bool    overflow { false };
+
+    bool operator==(Outcome const &) const = default;
+};
+
+struct Expected {
+    Outcome outcome {};
+    bool    flags { true };
+};
+
+struct Vector {
+    uint8_t op;
+    uint8_t lhs;
+    uint8_t rhs;
+    bool    carry;
+
+    explicit Vector(uint32_t index)
+        : op(static_cast<uint8_t>(index >> 17))
+        , lhs(static_cast<uint8_t>(index >> 8))
+        , rhs(static_cast<uint8_t>(index))
+        , carry(((index >> 16) & 0x01) != 0)
+    {
+    }
+};
+
+struct Mismatch {
+    uint32_t index;
+    Expected expected;
+    Outcome  actual;
+};
+
+struct Report {
+    std::array<size_t, 16>                mismatches {};
+    std::array<std::vector<Mismatch>, 16> examples {};
+    size_t                                vectors { 0 };
+    size_t                                max_examples { 8 };
+
+    void check(uint32_t index, Outcome const &actual);
+    void merge(Report const &other);
+    void print(std::ostream &out) const;
+    [[nodiscard]] size_t total() const;
+};
+
+// The ALU as the README describes it. Subtraction is done as an addition of
+// the complement, so the carry out is the inverse of the borrow and a borrow
+// is taken in when the carry flag is clear. The carry and overflow flags are
+// only defined for the arithmetic and shift operations.
+static Expected reference(Vector const &v)
+{
+    auto add = [](uint8_t a, uint8_t b, bool cin) -> Expected {
+        auto    sum = a + b + (cin ? 1 : 0);
+        uint8_t result = sum & 0xFF;
+        return { { result, sum > 0xFF, ((~(a ^ b) & (a ^ result)) & 0x80) != 0 } };
+    };
+    auto with_carry = (v.op & 0x08) != 0;
+    switch (v.op) {
+    case 0x0:
+    case 0x8:
+        return { { 0x00 }, false };
+    case 0x1:
+    case 0x9:
+        return add(v.rhs, ~v.lhs, !with_carry || v.carry);
+    case 0x2:
+    case 0xA:
+        return add(v.lhs, ~v.rhs, !with_carry || v.carry);
+    case 0x3:
+    case 0xB:
+        return add(v.lhs, v.rhs, with_carry && v.carry);
+    case 0x4:
+        return { { static_cast<uint8_t>(v.lhs ^ v.rhs) }, false };
+    case 0x5:
+        return { { static_cast<uint8_t>(v.lhs | v.rhs) }, false };
+    case 0x6:
+        return { { static_cast<uint8_t>(v.lhs & v.rhs) }, false };
+    case 0x7:
+        return { { 0xFF }, false };
+    case 0xC:
+    case 0xD: {
+        auto cin = (v.op & 0x01) != 0 && v.carry;
+        return { { static_cast<uint8_t>((v.rhs << 1) | (cin ? 0x01 : 0x00)), (v.rhs & 0x80) != 0, false } };
+    }
+    case 0xE:
+    case 0xF: {
+        auto cin = (v.op & 0x01) != 0 && v.carry;
+        return { { static_cast<uint8_t>((v.rhs >> 1) | (cin ? 0x80 : 0x00)), (v.rhs & 0x01) != 0, false } };
+    }
+    default:
+        UNREACHABLE();
+    }
+}
+
+void Report::check(uint32_t index, Outcome const &actual)
+{
+    ++vectors;
+    auto expected = reference(Vector { index });
+    auto ok = (expected.flags) ? actual == expected.outcome : actual.result == expected.outcome.result;
+    if (ok) {
+        return;
+    }
+    auto op = index >> 17;
+    if (mismatches[op]++ < max_examples) {
+        examples[op].push_back({ index, expected, actual });
+    }
+}
+
+void Report::merge(Report const &other)
+{
+    vectors += other.vectors;
+    for (auto op = 0; op < 16; ++op) {
+        mismatches[op] += other.mismatches[op];
+        for (auto const &m : other.examples[op]) {
+            if (examples[op].size() < max_examples) {
+                examples[op].push_back(m);
+            }
+        }
+        std::ranges::sort(examples[op], {}, &Mismatch::index);
+    }
+}
+
+size_t Report::total() const
+{
+    size_t ret = 0;
+    for (auto count : mismatches) {
+        ret += count;
+    }
+    return ret;
+}
+
+void Report::print(std::ostream &out) const
+{
+    std::println(out, "{:>4} {:<12} {:>10}", "Op", "Operation", "Mismatches");
+    for (auto op = 0; op < 16; ++op) {
+        std::println(out, "{:>#4x} {:<12} {:>10}", op, mnemonics[op], mismatches[op]);
+    }
+    for (auto op = 0; op < 16; ++op) {
+        if (examples[op].empty()) {
+            continue;
+        }
+        std::println(out, "\n{:#x} {}:", op, mnemonics[op]);
+        for (auto const &m : examples[op]) {
+            Vector v { m.index };
+            std::print(out, "  LHS {:#04x} RHS {:#04x} C {}: expected {:#04x}", v.lhs, v.rhs, v.carry ? 1 : 0, m.expected.outcome.result);
+            if (m.expected.flags) {
+                std::print(out, " C {} O {}", m.expected.outcome.carry ? 1 : 0, m.expected.outcome.overflow ? 1 : 0);
+            }
+            std::print(out, ", got {:#04x}", m.actual.result);
+            if (m.expected.flags) {
+                std::print(out, " C {} O {}", m.actual.carry ? 1 : 0, m.actual.overflow ? 1 : 0);
+            }
+            out << "\n";
+        }
+    }
+}
+
+// The pins of the card that are driven with a vector and the pins the
+// outcome is read from. The RHS is driven both on the bus, which feeds the
+// shifter, and on the B inputs of the adders behind the U2 transceiver.
+struct Probes {
+    std::vector<std::pair<Pin *, size_t>> stimulus {};
+    std::array<Pin *, 8>                  sum {};
+    std::array<Pin *, 8>                  shifted {};
+    Pin                                  *carry;
+    Pin                                  *overflow;
+
+    explicit Probes(ALU *alu)
+        : shifted(alu->U16->A)
+        , carry(alu->C)
+        , overflow(alu->O)
+    {
+        for (auto bit = 0; bit < 8; ++bit) {
+            stimulus.emplace_back(alu->bus->D[bit], bit);
+            stimulus.emplace_back((bit < 4) ? alu->U3->B[bit] : alu->U4->B[bit - 4], bit);
+            stimulus.emplace_back(alu->U1->Q[bit], 8 + bit);
+        }
+        stimulus.emplace_back(alu->CFlag, 16);
+        for (auto bit = 0; bit < 4; ++bit) {
+            stimulus.emplace_back(alu->bus->OP[bit], 17 + bit);
+        }
+        sum = alu->U21->A;
+    }
+};
+
+// Builds the System and sets up the bus for a PUT to the ALU operation
+// register with the clock held low, so that the LHS and flags latches keep
+// the values loaded into them. The optimization passes are skipped: they
+// would fold the bus lines the vectors are driven on into constants.
+static ALU *build_system(std::unique_ptr<System> &system)
+{
+    system = std::make_unique<System>(Font {});
+    system->keep_all = true;
+    system->history_budget = 0;
+    system->prepare();
+    system->circuit.prepare();
+    auto *bus = system->bus;
+    bus->set_put(0x05);
+    bus->set_get(0x0D);
+    bus->XDATA_->new_state = PinState::Low;
+    system->circuit.step(64);
+    for (auto const &card : system->cards) {
+        if (auto *alu = dynamic_cast<ALU *>(card.circuit); alu != nullptr) {
+            return alu;
+        }
+    }
+    return nullptr;
+}
+
+static uint64_t lane_word(size_t bit, uint32_t first)
+{
+    static constexpr uint64_t patterns[6] = {
+        0xAAAAAAAAAAAAAAAAull,
+        0xCCCCCCCCCCCCCCCCull,
+        0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull,
+        0xFFFF0000FFFF0000ull,
+        0xFFFFFFFF00000000ull,
+    };
+    if (bit < 6) {
+        return patterns[bit];
+    }
+    return ((first >> bit) & 0x01) ? ~0ull : 0ull;
+}
+
+// Follows the feeds of a pin until a pin known to the AIG is found.
+template<typename T>
+static std::optional<T> find_pin(std::unordered_map<Pin *, T> const &pins, Pin *pin)
+{
+    for (auto hops = 0; pin != nullptr && hops < Circuit::the().pin_count; pin = pin->feed, ++hops) {
+        if (auto it = pins.find(pin); it != pins.end()) {
+            return it->second;
+        }
+    }
+    return {};
+}
+
+static void run_aig(std::vector<uint8_t> const &ops, size_t threads, Report &report)
+{
+    auto                   &circuit = Circuit::the();
+    std::unique_ptr<System> system;
+    auto                   *alu = build_system(system);
+    Probes                  probes { alu };
+
+    // The flags latch closes a loop from the carry flag through the adders
+    // back to its own D input. Gates in a loop are not lowered, so the loop
+    // is cut; the carry flag is driven as part of the vector anyway.
+    for (auto bit = 0; bit < 3; ++bit) {
+        alu->U8->D[bit]->feed = nullptr;
+    }
+    auto const *aig = lower_to_aig(circuit);
+    std::println("{}", *aig);
+
+    std::unordered_map<Pin *, size_t>       inputs {};
+    std::unordered_map<Pin *, AIG::Literal> outputs {};
+    std::vector<uint64_t>                   initial { aig->values };
+    for (auto const &[pin, lit] : aig->inputs) {
+        inputs[pin] = lit >> 1;
+        initial[lit >> 1] = (pin->state == PinState::High) ? ~0ull : 0ull;
+    }
+    for (auto const &[pin, lit] : aig->outputs) {
+        outputs[pin] = lit;
+    }
+    std::vector<std::pair<size_t, size_t>> stimulus {};
+    for (auto const &[pin, bit] : probes.stimulus) {
+        if (auto node = find_pin(inputs, pin); node) {
+            stimulus.emplace_back(*node, bit);
+        }
+    }
+    auto literal = [&outputs](Pin *pin) -> AIG::Literal {
+        if (auto lit = find_pin(outputs, pin); lit) {
+            return *lit;
+        }
+        fatal("Pin {} is not driven by the AIG", pin->name);
+    };
+    std::array<AIG::Literal, 8> sum {};
+    std::array<AIG::Literal, 8> shifted {};
+    for (auto bit = 0; bit < 8; ++bit) {
+        sum[bit] = literal(probes.sum[bit]);
+        shifted[bit] = literal(probes.shifted[bit]);
+    }
+    auto carry = literal(probes.carry);
+    auto overflow = literal(probes.overflow);
+
+    std::vector<uint32_t> passes {};
+    for (auto op : ops) {
+        for (uint32_t first = op * VectorsPerOp; first < (op + 1) * VectorsPerOp; first += Lanes) {
+            passes.push_back(first);
+        }
+    }
+    std::atomic<size_t>      next { 0 };
+    std::vector<Report>      reports(threads, Report { .max_examples = report.max_examples });
+    std::vector<std::thread> workers {};
+    for (auto t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            auto values = initial;
+            for (auto ix = next++; ix < passes.size(); ix = next++) {
+                auto first = passes[ix];
+                for (auto const &[node, bit] : stimulus) {
+                    values[node] = lane_word(bit, first);
+                }
+                aig->evaluate_nodes(values);
+                auto const &result = (first >> 17 >= 0x0C) ? shifted : sum;
+                for (auto lane = 0; lane < Lanes; ++lane) {
+                    Outcome actual {};
+                    for (auto bit = 0; bit < 8; ++bit) {
+                        actual.result |= ((AIG::value(values, result[bit]) >> lane) & 0x01) << bit;
+                    }
+                    actual.carry = ((AIG::value(values, carry) >> lane) & 0x01) != 0;
+                    actual.overflow = ((AIG::value(values, overflow) >> lane) & 0x01) != 0;
+                    reports[t].check(first + lane, actual);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto const &r : reports) {
+        report.merge(r);
+    }
+}
+
+static void run_event(std::vector<uint8_t> const &ops, uint32_t stride, size_t ticks, Report &report)
+{
+    auto                   &circuit = Circuit::the();
+    std::unique_ptr<System> system;
+    auto                   *alu = build_system(system);
+    Probes                  probes { alu };
+    for (auto op : ops) {
+        for (uint32_t index = op * VectorsPerOp; index < (op + 1) * VectorsPerOp; index += stride) {
+            Vector v { index };
+            alu->U1->load(v.lhs);
+            alu->U8->load(v.carry ? 0x01 : 0x00);
+            alu->bus->set_op(v.op);
+            alu->bus->set_data(v.rhs);
+            circuit.step(ticks);
+            auto const &result = (v.op >= 0x0C) ? probes.shifted : probes.sum;
+            Outcome     actual {};
+            for (auto bit = 0; bit < 8; ++bit) {
+                actual.result |= (result[bit]->on() ? 1 : 0) << bit;
+            }
+            actual.carry = probes.carry->on();
+            actual.overflow = probes.overflow->on();
+            report.check(index, actual);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Lib::parse_options(argc, const_cast<char const **>(argv));
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    if (auto t = Lib::get_option("threads"); t) {
+        std::from_chars(t->data(), t->data() + t->size(), threads);
+        threads = std::max<size_t>(threads, 1);
+    }
+    Report report {};
+    if (auto n = Lib::get_option("examples"); n) {
+        std::from_chars(n->data(), n->data() + n->size(), report.max_examples);
+    }
+    std::vector<uint8_t> ops {};
+    for (auto const &value : Lib::get_option_values("op")) {
+        uint8_t op { 0 };
+        auto    base = (value.starts_with("0x")) ? 16 : 10;
+        auto    digits = (base == 16) ? value.substr(2) : value;
+        std::from_chars(digits.data(), digits.data() + digits.size(), op, base);
+        ops.push_back(op & 0x0F);
+    }
+    if (ops.empty()) {
+        for (uint8_t op = 0; op < 16; ++op) {
+            ops.push_back(op);
+        }
+    }
+    auto     engine = Lib::get_option("engine").value_or("aig");
+    uint32_t stride { 1 };
+    if (auto s = Lib::get_option("stride"); s) {
+        std::from_chars(s->data(), s->data() + s->size(), stride);
+    }
+    size_t ticks { 64 };
+    if (auto t = Lib::get_option("ticks"); t) {
+        std::from_chars(t->data(), t->data() + t->size(), ticks);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (engine == "event") {
+        threads = 1;
+        run_event(ops, std::max(stride, 1u), ticks, report);
+    } else {
+        run_aig(ops, threads, report);
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.print(std::cout);
+    std::println("\n{} vectors, {} mismatches in {:.2f}s ({} engine, {} threads)",
+        report.vectors, report.total(), seconds, engine, threads);
+    return (report.total() > 0) ? 1 : 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    return Simul::main(argc, argv);
+}
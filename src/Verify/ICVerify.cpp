@@ -0,0 +1,613 @@
+/*
+ * Copyright (c) 2025, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <print>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include <Lib/Logging.h>
+#include <Lib/Options.h>
+
+#include "Circuit/Circuit.h"
+#include "Circuit/Model.h"
+#include "Circuit/Optimize.h"
+#include "Circuit/UtilityDevice.h"
+#include "IC/LS00.h"
+#include "IC/LS02.h"
+#include "IC/LS04.h"
+#include "IC/LS08.h"
+#include "IC/LS138.h"
+#include "IC/LS139.h"
+#include "IC/LS157.h"
+#include "IC/LS193.h"
+#include "IC/LS21.h"
+#include "IC/LS245.h"
+#include "IC/LS32.h"
+#include "IC/LS377.h"
+#include "IC/LS382.h"
+#include "IC/LS574.h"
+#include "IC/LS86.h"
+
+namespace Simul {
+
+// Differential verification of the chip models in src/IC. Every chip is
+// checked against a golden spec: a function from the input vector to the
+// expected outputs. For sequential chips the spec also carries the chip's
+// state from one vector to the next, and gets the previous input vector to
+// see clock edges.
+//
+// Combinational chips with at most --exhaustive inputs (16 by default) get
+// every input vector, the others --random random vectors. Sequential chips
+// get --sequences random sequences of --steps vectors. Every sequence starts
+// with the spec's init vectors, which bring the chip into a known state, and
+// then changes one random input per step, so there are no races between
+// inputs. Vectors the spec does not allow, such as both clocks of a LS193
+// low, are skipped. Each chip runs in its own process, --jobs at a time,
+// since there is only one Circuit per process.
+//
+// With --pass the chip is transformed before it is verified, so that an
+// optimization pass or a replacement of the gates can be checked against
+// the same specs.
+
+// Expected levels of the outputs. Outputs set in z are expected to float,
+// outputs set in dont_care are not checked.
+struct Expect {
+    uint64_t value { 0 };
+    uint64_t z { 0 };
+    uint64_t dont_care { 0 };
+};
+
+// Outputs set in three_state are read as Z when their driver lets go of
+// them: a tri-state buffer stops driving but keeps its last level.
+struct Harness {
+    Device            *chip { nullptr };
+    std::vector<Pin *> inputs {};
+    std::vector<Pin *> outputs {};
+    uint64_t           three_state { 0 };
+};
+
+struct Spec {
+    using Eval = std::function<Expect(uint64_t &state, uint64_t prev, uint64_t in)>;
+
+    std::string                          name;
+    std::function<Harness(Circuit &)>    build;
+    Eval                                 eval;
+    bool                                 sequential { false };
+    std::vector<uint64_t>                init {};
+    std::function<uint64_t(uint64_t in)> driven {};
+    std::function<bool(uint64_t in)>     legal {};
+};
+
+template<typename... Groups>
+static std::vector<Pin *> pins(Groups const &...groups)
+{
+    std::vector<Pin *> ret {};
+    auto               append = [&ret](auto const &group) {
+        if constexpr (std::is_convertible_v<decltype(group), Pin *>) {
+            ret.push_back(group);
+        } else {
+            ret.insert(ret.end(), group.begin(), group.end());
+        }
+    };
+    (append(groups), ...);
+    return ret;
+}
+
+static bool bit(uint64_t value, int ix)
+{
+    return ((value >> ix) & 0x01) != 0;
+}
+
+static uint64_t field(uint64_t value, int ix, int bits)
+{
+    return (value >> ix) & ((1ull << bits) - 1);
+}
+
+static bool rising(uint64_t prev, uint64_t in, int ix)
+{
+    return !bit(prev, ix) && bit(in, ix);
+}
+
+// Quad and hex gates. The inputs are all A pins followed by all B pins.
+template<typename Chip, size_t Gates>
+static Spec gates(std::string name, std::function<bool(bool, bool)> op)
+{
+    return {
+        std::move(name),
+        [](Circuit &circuit) -> Harness {
+            auto *chip = circuit.add_component<Chip>();
+            return { chip, pins(chip->A, chip->B), pins(chip->Y) };
+        },
+        [op](uint64_t &, uint64_t, uint64_t in) -> Expect {
+            Expect ret {};
+            for (auto ix = 0; ix < Gates; ++ix) {
+                ret.value |= static_cast<uint64_t>(op(bit(in, ix), bit(in, Gates + ix))) << ix;
+            }
+            return ret;
+        },
+    };
+}
+
+static std::vector<Spec> specs()
+{
+    return {
+        gates<LS00, 4>("LS00", [](bool a, bool b) { return !(a && b); }),
+        gates<LS02, 4>("LS02", [](bool a, bool b) { return !(a || b); }),
+        {
+            "LS04",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS04>();
+                return { chip, pins(chip->A), pins(chip->Y) };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                return { ~in & 0x3F };
+            },
+        },
+        gates<LS08, 4>("LS08", [](bool a, bool b) { return a && b; }),
+        // A[0], A[1], B[0], B[1], C[0], C[1], D[0], D[1]
+        {
+            "LS21",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS21>();
+                return { chip, pins(chip->A, chip->B, chip->C, chip->D), pins(chip->Y) };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                return { field(in, 0, 2) & field(in, 2, 2) & field(in, 4, 2) & field(in, 6, 2) };
+            },
+        },
+        gates<LS32, 4>("LS32", [](bool a, bool b) { return a || b; }),
+        gates<LS86, 4>("LS86", [](bool a, bool b) { return a != b; }),
+        // A, B, C, G1, G2A, G2B
+        {
+            "LS138",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS138>();
+                return { chip, pins(chip->A, chip->B, chip->C, chip->G1, chip->G2A, chip->G2B), pins(chip->Y) };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                if (bit(in, 3) && !bit(in, 4) && !bit(in, 5)) {
+                    return { 0xFF & ~(1ull << field(in, 0, 3)) };
+                }
+                return { 0xFF };
+            },
+        },
+        // G[0], G[1], A[0], A[1], B[0], B[1]. Outputs Y0-Y3 of the first
+        // decoder, then Y0-Y3 of the second.
+        {
+            "LS139",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS139>();
+                return {
+                    chip,
+                    pins(chip->G, chip->A, chip->B),
+                    pins(chip->Y0[0], chip->Y1[0], chip->Y2[0], chip->Y3[0], chip->Y0[1], chip->Y1[1], chip->Y2[1], chip->Y3[1]),
+                };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                Expect ret { 0xFF };
+                for (auto ix = 0; ix < 2; ++ix) {
+                    if (!bit(in, ix)) {
+                        auto selected = (bit(in, 4 + ix) << 1) | bit(in, 2 + ix);
+                        ret.value &= ~(1ull << (4 * ix + selected));
+                    }
+                }
+                return ret;
+            },
+        },
+        // I0[0-3], I1[0-3], S, E_
+        {
+            "LS157",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS157>();
+                return { chip, pins(chip->I0, chip->I1, chip->S, chip->E_), pins(chip->Z) };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                if (bit(in, 9)) {
+                    return { 0x00 };
+                }
+                return { field(in, bit(in, 8) ? 4 : 0, 4) };
+            },
+        },
+        // D[0-3], Up, Down, CLR, Load_. Outputs Q[0-3], CO_, BO_.
+        {
+            "LS193",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS193>();
+                return { chip, pins(chip->D, chip->Up, chip->Down, chip->CLR, chip->Load_), pins(chip->Q, chip->CO_, chip->BO_) };
+            },
+            [](uint64_t &state, uint64_t prev, uint64_t in) -> Expect {
+                if (bit(in, 6)) {
+                    state = 0;
+                } else if (!bit(in, 7)) {
+                    state = field(in, 0, 4);
+                } else if (rising(prev, in, 4) && bit(in, 5)) {
+                    state = (state + 1) & 0x0F;
+                } else if (rising(prev, in, 5) && bit(in, 4)) {
+                    state = (state - 1) & 0x0F;
+                }
+                auto carry = state == 0x0F && !bit(in, 4);
+                auto borrow = state == 0x00 && !bit(in, 5);
+                return { state | (carry ? 0x00 : 0x10) | (borrow ? 0x00 : 0x20) };
+            },
+            true,
+            { 0xF0, 0xB0 },
+            {},
+            // One of the clocks must be held high while the other one counts.
+            [](uint64_t in) -> bool {
+                return bit(in, 4) || bit(in, 5);
+            },
+        },
+        // A[0-7], B[0-7], DIR, OE_. The outputs are the same A and B pins;
+        // the side that is not an output is driven by the harness.
+        {
+            "LS245",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS245>();
+                return { chip, pins(chip->A, chip->B, chip->DIR, chip->OE_), pins(chip->A, chip->B) };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                auto a = field(in, 0, 8);
+                auto b = field(in, 8, 8);
+                if (!bit(in, 17) && bit(in, 16)) {
+                    b = a;
+                } else if (!bit(in, 17)) {
+                    a = b;
+                }
+                return { a | (b << 8) };
+            },
+            false,
+            {},
+            [](uint64_t in) -> uint64_t {
+                if (bit(in, 17)) {
+                    return ~0ull;
+                }
+                return bit(in, 16) ? ~0xFF00ull : ~0x00FFull;
+            },
+        },
+        // D[0-7], E_, CLK
+        {
+            "LS377",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS377>();
+                return { chip, pins(chip->D, chip->E_, chip->CLK), pins(chip->Q) };
+            },
+            [](uint64_t &state, uint64_t prev, uint64_t in) -> Expect {
+                if (rising(prev, in, 9) && !bit(in, 8)) {
+                    state = field(in, 0, 8);
+                }
+                return { state };
+            },
+            true,
+            { 0x000, 0x200 },
+        },
+        // A[0-3], B[0-3], S[0-2], Cin. Outputs F[0-3], Cout, OVR. Carry and
+        // overflow are only defined for the arithmetic functions.
+        {
+            "LS382",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS382>();
+                return { chip, pins(chip->A, chip->B, chip->S, chip->Cin), pins(chip->F, chip->Cout, chip->OVR) };
+            },
+            [](uint64_t &, uint64_t, uint64_t in) -> Expect {
+                auto a = field(in, 0, 4);
+                auto b = field(in, 4, 4);
+                auto cin = field(in, 11, 1);
+                auto add = [cin](uint64_t x, uint64_t y) -> Expect {
+                    auto sum = x + y + cin;
+                    auto c3 = ((x & 0x07) + (y & 0x07) + cin) >> 3;
+                    auto c4 = sum >> 4;
+                    return { (sum & 0x0F) | (c4 << 4) | ((c3 ^ c4) << 5) };
+                };
+                switch (field(in, 8, 3)) {
+                case 0:
+                    return { 0x00, 0, 0x30 };
+                case 1:
+                    return add(b, ~a & 0x0F);
+                case 2:
+                    return add(a, ~b & 0x0F);
+                case 3:
+                    return add(a, b);
+                case 4:
+                    return { a ^ b, 0, 0x30 };
+                case 5:
+                    return { a | b, 0, 0x30 };
+                case 6:
+                    return { a & b, 0, 0x30 };
+                default:
+                    return { 0x0F, 0, 0x30 };
+                }
+            },
+        },
+        // D[0-7], CLK, OE_
+        {
+            "LS574",
+            [](Circuit &circuit) -> Harness {
+                auto *chip = circuit.add_component<LS574>();
+                return { chip, pins(chip->D, chip->CLK, chip->OE_), pins(chip->Q), 0xFF };
+            },
+            [](uint64_t &state, uint64_t prev, uint64_t in) -> Expect {
+                if (rising(prev, in, 8)) {
+                    state = field(in, 0, 8);
+                }
+                if (bit(in, 9)) {
+                    return { 0x00, 0xFF };
+                }
+                return { state };
+            },
+            true,
+            { 0x000, 0x100 },
+        },
+    };
+}
+
+struct Options {
+    size_t      exhaustive { 16 };
+    size_t      random { 4096 };
+    size_t      sequences { 64 };
+    size_t      steps { 256 };
+    size_t      examples { 4 };
+    uint64_t    seed { 0x5eed };
+    std::string pass {};
+    size_t      cone_inputs { 12 };
+};
+
+struct Result {
+    size_t             vectors { 0 };
+    size_t             mismatches { 0 };
+    std::ostringstream examples {};
+};
+
+static void transform(Circuit &circuit, Harness const &harness, Options const &options)
+{
+    auto const &pass = options.pass;
+    if (pass == "optimize") {
+        optimize(circuit);
+        eliminate_dead_logic(circuit, harness.outputs);
+    } else if (pass == "aig") {
+        lower_to_aig(circuit);
+    } else if (pass.starts_with("cones")) {
+        compile_cones(circuit, options.cone_inputs);
+    } else if (pass == "models") {
+        compile_models(circuit, { harness.chip });
+    }
+}
+
+// Drives one input vector onto the chip, lets the chip settle and compares
+// its outputs with the spec.
+struct Driver {
+    Spec const            &spec;
+    Options const         &options;
+    Circuit               &circuit;
+    Harness                harness {};
+    std::vector<TieDown *> stimulus {};
+    uint64_t               state { 0 };
+    uint64_t               prev { 0 };
+    Result                 result {};
+
+    Driver(Spec const &spec, Options const &options)
+        : spec(spec)
+        , options(options)
+        , circuit(Circuit::the())
+    {
+        circuit.initialize(spec.name);
+        harness = spec.build(circuit);
+        for (auto *pin : harness.inputs) {
+            auto *tiedown = stimulus.emplace_back(circuit.add_component<TieDown>(PinState::Low));
+            tiedown->Y->drive = pin;
+            tiedown->Y->driving = tiedown->Y->new_driving = true;
+        }
+        transform(circuit, harness, options);
+        set(spec.init.empty() ? 0 : spec.init.front());
+        for (auto ix = 0; ix < harness.inputs.size(); ++ix) {
+            harness.inputs[ix]->state = stimulus[ix]->Y->state = stimulus[ix]->Y->new_state;
+        }
+        circuit.prepare();
+        circuit.settle();
+    }
+
+    void set(uint64_t in)
+    {
+        auto driven = (spec.driven) ? spec.driven(in) : ~0ull;
+        for (auto ix = 0; ix < stimulus.size(); ++ix) {
+            auto *Y = stimulus[ix]->Y;
+            Y->new_state = bit(in, ix) ? PinState::High : PinState::Low;
+            Y->new_driving = bit(driven, ix);
+        }
+    }
+
+    void apply(uint64_t in, bool check, size_t step = 0)
+    {
+        set(in);
+        circuit.settle();
+        auto expected = spec.eval(state, prev, in);
+        prev = in;
+        if (!check) {
+            return;
+        }
+        ++result.vectors;
+        uint64_t value { 0 };
+        uint64_t z { 0 };
+        for (auto ix = 0; ix < harness.outputs.size(); ++ix) {
+            auto *pin = harness.outputs[ix];
+            if (bit(harness.three_state, ix) && !pin->new_driving) {
+                z |= 1ull << ix;
+                continue;
+            }
+            switch (pin->new_state) {
+            case PinState::High:
+                value |= 1ull << ix;
+                break;
+            case PinState::Z:
+                z |= 1ull << ix;
+                break;
+            default:
+                break;
+            }
+        }
+        auto care = ~expected.dont_care & ((1ull << harness.outputs.size()) - 1);
+        if (((value ^ expected.value) & care & ~expected.z) == 0 && ((z ^ expected.z) & care) == 0) {
+            return;
+        }
+        if (result.mismatches++ < options.examples) {
+            std::print(result.examples, "  ");
+            if (spec.sequential) {
+                std::print(result.examples, "step {:>4}: ", step);
+            }
+            std::println(result.examples, "inputs {:#0{}b}: expected {}, got {}",
+                in, harness.inputs.size() + 2,
+                levels(expected.value, expected.z, expected.dont_care), levels(value, z, 0));
+        }
+    }
+
+    // Outputs as a string of levels, highest pin first: 0, 1, Z, or - for
+    // an output that is not checked.
+    [[nodiscard]] std::string levels(uint64_t value, uint64_t z, uint64_t dont_care) const
+    {
+        std::string ret {};
+        for (auto ix = harness.outputs.size() - 1; ix < harness.outputs.size(); --ix) {
+            ret += bit(dont_care, ix) ? '-' : bit(z, ix) ? 'Z' : bit(value, ix) ? '1' : '0';
+        }
+        return ret;
+    }
+
+    void run()
+    {
+        std::mt19937_64 rng { options.seed };
+        auto            inputs = harness.inputs.size();
+        if (!spec.sequential) {
+            if (inputs <= options.exhaustive) {
+                for (uint64_t in = 0; in < (1ull << inputs); ++in) {
+                    apply(in, true);
+                }
+            } else {
+                for (auto ix = 0; ix < options.random; ++ix) {
+                    apply(rng() & ((1ull << inputs) - 1), true);
+                }
+            }
+            return;
+        }
+        for (auto sequence = 0; sequence < options.sequences; ++sequence) {
+            state = 0;
+            prev = spec.init.front();
+            for (auto in : spec.init) {
+                apply(in, false);
+            }
+            auto in = spec.init.back();
+            for (auto step = 0; step < options.steps; ++step) {
+                auto next = in ^ (1ull << (rng() % inputs));
+                while (spec.legal && !spec.legal(next)) {
+                    next = in ^ (1ull << (rng() % inputs));
+                }
+                in = next;
+                apply(in, true, step);
+            }
+        }
+    }
+};
+
+static bool verify(Spec const &spec, Options const &options)
+{
+    auto   start = std::chrono::steady_clock::now();
+    Driver driver { spec, options };
+    driver.run();
+    auto        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    auto const &result = driver.result;
+
+    std::ostringstream out;
+    std::println(out, "{} {:<6} {:>8} vectors {:>8} mismatches ({:.1f} ms)",
+        (result.mismatches == 0) ? "PASS" : "FAIL", spec.name, result.vectors, result.mismatches, ms);
+    out << result.examples.str();
+    auto report = out.str();
+    std::ignore = write(STDOUT_FILENO, report.data(), report.size());
+    return result.mismatches == 0;
+}
+
+int main(int argc, char **argv)
+{
+    Lib::parse_options(argc, const_cast<char const **>(argv));
+    Options options {};
+    auto    number = [](std::string_view option, auto &value) {
+        if (auto v = Lib::get_option(option); v) {
+            std::from_chars(v->data(), v->data() + v->size(), value);
+        }
+    };
+    number("exhaustive", options.exhaustive);
+    number("random", options.random);
+    number("sequences", options.sequences);
+    number("steps", options.steps);
+    number("examples", options.examples);
+    number("seed", options.seed);
+    options.pass = Lib::get_option("pass").value_or("");
+    if (auto eq = options.pass.find('='); options.pass.starts_with("cones") && eq != std::string::npos) {
+        std::from_chars(options.pass.data() + eq + 1, options.pass.data() + options.pass.size(), options.cone_inputs);
+        if (options.cone_inputs > MaxConeInputs) {
+            fatal("--pass=cones compiles cones of at most {} inputs", MaxConeInputs);
+        }
+    }
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    number("jobs", jobs);
+    jobs = std::max<size_t>(jobs, 1);
+
+    auto all = specs();
+    auto only = Lib::get_option_values("chip");
+    if (!options.pass.empty()) {
+        std::println("Verifying after pass '{}'", options.pass);
+    }
+
+    // One child process per chip, with at most jobs children running. Every
+    // child writes its report with a single write, so reports of chips that
+    // finish at the same time do not interleave.
+    auto   failures = 0;
+    size_t running = 0;
+    size_t chips = 0;
+    auto   reap = [&failures, &running]() {
+        auto status = 0;
+        wait(&status);
+        failures += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        --running;
+    };
+    std::fflush(stdout);
+    for (auto const &spec : all) {
+        if (!only.empty() && std::ranges::find(only, spec.name) == only.end()) {
+            continue;
+        }
+        if (running == jobs) {
+            reap();
+        }
+        ++chips;
+        if (auto pid = fork(); pid == 0) {
+            _exit(verify(spec, options) ? 0 : 1);
+        } else if (pid < 0) {
+            fatal("Could not start verification of {}", spec.name);
+        }
+        ++running;
+    }
+    while (running > 0) {
+        reap();
+    }
+    std::println("{} of {} chips failed", failures, chips);
+    return (failures > 0) ? 1 : 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    return Simul::main(argc, argv);
+}